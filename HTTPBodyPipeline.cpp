@@ -0,0 +1,134 @@
+#include "HTTPBodyPipeline.h"
+
+
+
+HTTPBodyPipeline::HTTPBodyPipeline(size_t bufferCount, size_t bufferSize) :
+  bufferCount((bufferCount < HTTP_PIPELINE_MAX_BUFFERS) ? bufferCount : HTTP_PIPELINE_MAX_BUFFERS),
+  storage(new uint8_t[this->bufferCount * bufferSize]),
+  pool(nullptr)
+{
+  for (size_t i = 0; i < this->bufferCount; ++i) {
+    buffers[i].data = storage + i * bufferSize;
+    buffers[i].capacity = bufferSize;
+  }
+
+  reset();
+}
+
+
+
+HTTPBodyPipeline::HTTPBodyPipeline(HTTPBufferPool& pool, size_t bufferCount) :
+  bufferCount(0),
+  storage(nullptr),
+  pool(&pool)
+{
+  uint8_t* data;
+
+  while (this->bufferCount < bufferCount && this->bufferCount < HTTP_PIPELINE_MAX_BUFFERS && (data = pool.acquire()) != nullptr) {
+    buffers[this->bufferCount].data = data;
+    buffers[this->bufferCount].capacity = pool.bufferSize();
+    ++this->bufferCount;
+  }
+
+  if (this->bufferCount < bufferCount) {
+    Serial.printf(F("[HTTPBodyPipeline] Buffer pool only provided %u of %u buffers\n"), (unsigned)this->bufferCount, (unsigned)bufferCount);
+  }
+
+  reset();
+}
+
+
+
+HTTPBodyPipeline::~HTTPBodyPipeline()
+{
+  if (pool != nullptr) {
+    for (size_t i = 0; i < bufferCount; ++i) {
+      pool->release(buffers[i].data);
+    }
+  }
+
+  delete[] storage;
+}
+
+
+
+void HTTPBodyPipeline::reset() {
+  freeBuffers.clear();
+  filledBuffers.clear();
+
+  for (size_t i = 0; i < bufferCount; ++i) {
+    buffers[i].length = 0;
+    freeBuffers.push(&buffers[i]);
+  }
+
+  producerDone.store(false, std::memory_order_release);
+  stopRequested.store(false, std::memory_order_release);
+  producerResult.store(0, std::memory_order_release);
+}
+
+
+
+/// <summary>
+/// Reads the entire body of the current response, handing each filled buffer to the application task.
+/// Blocks the calling (network) task while every buffer is waiting to be processed.
+/// </summary>
+/// <param name="client">The client the response is being read from</param>
+/// <returns>The total number of bytes read, or -1 if the application task stopped the pipeline</returns>
+long int HTTPBodyPipeline::produce(HTTPClient& client) {
+  HTTPBodyBuffer* buffer;
+  long int total = 0;
+  size_t r;
+
+  while (true) {
+    while (!freeBuffers.pop(buffer)) {
+      if (stopRequested.load(std::memory_order_acquire)) {
+        Serial.println(F("[HTTPBodyPipeline] Stopped by the consumer"));
+
+        producerResult.store(-1, std::memory_order_release);
+        producerDone.store(true, std::memory_order_release);
+        return -1;
+      }
+      yield();
+    }
+
+    r = client.readBytes((char*)buffer->data, buffer->capacity);
+    total += r;
+
+    // Once pushed the buffer belongs to the application task, only our local copy of its length is used afterwards.
+    // An empty read is held onto by the producer, reset() hands it back
+    if (r > 0) {
+      buffer->length = r;
+      filledBuffers.push(buffer);
+    }
+
+    if (r < buffer->capacity) {
+      break;
+    }
+  }
+
+  Serial.printf(F("[HTTPBodyPipeline] Finished producing %ld bytes\n"), total);
+
+  producerResult.store(total, std::memory_order_release);
+  producerDone.store(true, std::memory_order_release);
+
+  return total;
+}
+
+
+
+// Returns the next filled buffer, or nullptr if none is ready yet
+HTTPBodyBuffer* HTTPBodyPipeline::pop() {
+  HTTPBodyBuffer* buffer;
+
+  return filledBuffers.pop(buffer) ? buffer : nullptr;
+}
+
+
+
+// Hands a processed buffer back to the network task
+void HTTPBodyPipeline::release(HTTPBodyBuffer* buffer) {
+  if (buffer != nullptr) {
+    buffer->length = 0;
+    freeBuffers.push(buffer);
+  }
+}
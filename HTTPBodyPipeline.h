@@ -0,0 +1,73 @@
+#ifndef HTTP_BODY_PIPELINE_H
+#define HTTP_BODY_PIPELINE_H
+
+
+
+#include "HTTPClient.h"
+#include "HTTPSPSCQueue.h"
+
+#include <atomic>
+
+
+
+// Upper bound for the number of buffers a pipeline may cycle, must be a power of two
+#ifndef HTTP_PIPELINE_MAX_BUFFERS
+#define HTTP_PIPELINE_MAX_BUFFERS 8
+#endif
+
+
+
+struct HTTPBodyBuffer {
+  uint8_t* data = nullptr;
+  size_t capacity = 0;
+  size_t length = 0;
+};
+
+
+
+// Splits reading a response body between a network task and an application task.
+// The network task calls produce(), which runs the readBytes loop and hands every filled buffer over a lock-free queue.
+// The application task pops the filled buffers, processes them and releases them back to be filled again.
+// Buffers are allocated (or borrowed from a pool) once, when the pipeline is constructed, and recycled for every body read through it.
+class HTTPBodyPipeline
+{
+public:
+  HTTPBodyPipeline(size_t bufferCount = 4, size_t bufferSize = 1024);
+  // Borrows its buffers from a buffer pool for its lifetime, fewer than bufferCount are used if the pool runs short
+  HTTPBodyPipeline(HTTPBufferPool& pool, size_t bufferCount = 4);
+  virtual ~HTTPBodyPipeline();
+
+  // Network task
+  long int produce(HTTPClient& client);
+
+  // Application task
+  HTTPBodyBuffer* pop();
+  void release(HTTPBodyBuffer* buffer);
+  void stop() { stopRequested.store(true, std::memory_order_release); }
+
+  // True once the producer has finished and every filled buffer was popped
+  bool finished() const
+    { return producerDone.load(std::memory_order_acquire) && filledBuffers.empty(); }
+  long int result() const
+    { return producerResult.load(std::memory_order_acquire); }
+
+  // Returns every buffer to the pipeline for the next body, only call while neither task is using it
+  void reset();
+
+protected:
+  HTTPBodyBuffer buffers[HTTP_PIPELINE_MAX_BUFFERS];
+  size_t bufferCount;
+  uint8_t* storage;
+  HTTPBufferPool* pool;
+
+  HTTPSPSCQueue<HTTPBodyBuffer*, HTTP_PIPELINE_MAX_BUFFERS> freeBuffers;    // application -> network
+  HTTPSPSCQueue<HTTPBodyBuffer*, HTTP_PIPELINE_MAX_BUFFERS> filledBuffers;  // network -> application
+
+  std::atomic<bool> producerDone{false};
+  std::atomic<bool> stopRequested{false};
+  std::atomic<long int> producerResult{0};
+};
+
+
+
+#endif // HTTP_BODY_PIPELINE_H
@@ -0,0 +1,142 @@
+#include "HTTPBodySource.h"
+
+#if !defined(ARDUINO)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+
+long int HTTPMemorySource::read(uint8_t* buffer, size_t capacity) {
+  size_t n = size - position;
+
+  if (n == 0) {
+    return HTTP_SOURCE_END;
+  }
+
+  if (n > capacity) {
+    n = capacity;
+  }
+
+  if (flash) {
+    memcpy_P(buffer, data + position, n);
+  } else {
+    memcpy(buffer, data + position, n);
+  }
+
+  position += n;
+
+  return n;
+}
+
+
+
+long int HTTPCallbackSource::read(uint8_t* buffer, size_t capacity) {
+  long int n = producer(buffer, capacity);
+
+  if (n != 0) {
+    started = true;
+  }
+
+  // A producer must never claim more than it was given room for
+  if (n > (long int)capacity) {
+    return HTTP_SOURCE_ERROR;
+  }
+
+  return n;
+}
+
+
+
+long int HTTPStreamSource::read(uint8_t* buffer, size_t capacity) {
+  if (total >= 0) {
+    if ((long int)position >= total) {
+      return HTTP_SOURCE_END;
+    }
+
+    if ((long int)capacity > total - (long int)position) {
+      capacity = total - position;
+    }
+  }
+
+  int available = stream.available();
+
+  if (available <= 0) {
+    return (total >= 0) ? 0 : HTTP_SOURCE_END;
+  }
+
+  if ((size_t)available < capacity) {
+    capacity = available;
+  }
+
+  size_t n = stream.readBytes((char*)buffer, capacity);
+  position += n;
+
+  return n;
+}
+
+
+
+#if defined(ESP32)
+HTTPPartitionSource::HTTPPartitionSource(const esp_partition_t* partition, size_t offset, size_t length) :
+  HTTPMemorySource(nullptr, 0, false)
+{
+  const void* mapped = nullptr;
+
+  if (partition == nullptr || offset + length > partition->size
+      || esp_partition_mmap(partition, offset, length, ESP_PARTITION_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+    Serial.println(F("[HTTPBodySource] Could not map the partition"));
+    return;
+  }
+
+  data = (const uint8_t*)mapped;
+  size = length;
+}
+
+
+
+HTTPPartitionSource::~HTTPPartitionSource() {
+  if (data != nullptr) {
+    esp_partition_munmap(handle);
+  }
+}
+#endif
+
+
+
+#if !defined(ARDUINO)
+HTTPMappedFileSource::HTTPMappedFileSource(const char* path) :
+  HTTPMemorySource(nullptr, 0, false)
+{
+  struct stat info;
+  int fd = ::open(path, O_RDONLY);
+
+  if (fd < 0) {
+    return;
+  }
+
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (mapped != MAP_FAILED) {
+      madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+
+      data = (const uint8_t*)mapped;
+      size = info.st_size;
+    }
+  }
+
+  // The mapping stays valid once the descriptor is closed
+  ::close(fd);
+}
+
+
+
+HTTPMappedFileSource::~HTTPMappedFileSource() {
+  if (data != nullptr) {
+    munmap((void*)data, size);
+  }
+}
+#endif
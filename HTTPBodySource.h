@@ -0,0 +1,190 @@
+#ifndef HTTP_BODY_SOURCE_H
+#define HTTP_BODY_SOURCE_H
+
+
+
+#include <Arduino.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+#if defined(ESP32)
+#include <esp_partition.h>
+#endif
+
+
+
+// Returned by HTTPBodySource::read once the body has been read to its end
+#define HTTP_SOURCE_END   -1
+// Returned by HTTPBodySource::read when the data can not be read
+#define HTTP_SOURCE_ERROR -2
+
+
+
+// Where an upload's body comes from. The client pulls the body block by block straight into its transmit buffer,
+// so only one buffer's worth of it is ever in RAM.
+class HTTPBodySource
+{
+public:
+  virtual ~HTTPBodySource() {}
+
+  // Copies upto capacity bytes into buffer.
+  // Returns the number of bytes copied, 0 when nothing is ready yet, HTTP_SOURCE_END once exhausted or HTTP_SOURCE_ERROR
+  virtual long int read(uint8_t* buffer, size_t capacity) = 0;
+
+  // Total length in bytes, -1 when it is not known up front and the body has to be sent chunked
+  virtual long int length() const { return -1; }
+
+  // Goes back to the start so the body can be sent again, false if the source can not and has already been read from
+  virtual bool rewind() = 0;
+
+  // Sent as Content-Encoding when not nullptr, for sources that encode what they read
+  virtual const char* contentEncoding() const { return nullptr; }
+
+  // Sent as Content-Type when not nullptr, for sources that generate their own format (e.g. a multipart form's boundary)
+  virtual const char* contentType() const { return nullptr; }
+};
+
+
+
+// A body already in memory, in RAM or (with flash set) in flash read with memcpy_P
+class HTTPMemorySource : public HTTPBodySource
+{
+public:
+  HTTPMemorySource(const void* data, size_t length, bool flash = false) :
+    data((const uint8_t*)data), size(length), flash(flash) {}
+  HTTPMemorySource(const __FlashStringHelper* text) :
+    HTTPMemorySource(text, strlen_P((const char*)text), true) {}
+
+  virtual long int read(uint8_t* buffer, size_t capacity) override;
+  virtual long int length() const override { return size; }
+  virtual bool rewind() override { position = 0; return true; }
+
+protected:
+  const uint8_t* data;
+  size_t size;
+  size_t position = 0;
+  bool flash;
+};
+
+
+
+#if defined(ESP32)
+// A flash partition (or part of one) mapped into the address space, read straight out of flash without a copy in RAM
+class HTTPPartitionSource : public HTTPMemorySource
+{
+public:
+  HTTPPartitionSource(const esp_partition_t* partition, size_t offset, size_t length);
+  virtual ~HTTPPartitionSource();
+
+  bool valid() const { return data != nullptr; }
+
+protected:
+  esp_partition_mmap_handle_t handle;
+};
+#endif
+
+
+
+#if !defined(ARDUINO)
+// A file mmap'ed read only, for host builds
+class HTTPMappedFileSource : public HTTPMemorySource
+{
+public:
+  HTTPMappedFileSource(const char* path);
+  virtual ~HTTPMappedFileSource();
+
+  bool valid() const { return data != nullptr; }
+};
+#endif
+
+
+
+// Producer returning the number of bytes it wrote into buffer, 0 when it has nothing yet or HTTP_SOURCE_END when done
+typedef std::function<long int(uint8_t* buffer, size_t capacity)> HTTPBodyProducer;
+
+// A body generated while it is being sent, e.g. log lines as they are read out of a ring buffer
+class HTTPCallbackSource : public HTTPBodySource
+{
+public:
+  HTTPCallbackSource(HTTPBodyProducer producer, long int length = -1) :
+    producer(producer), total(length) {}
+
+  virtual long int read(uint8_t* buffer, size_t capacity) override;
+  virtual long int length() const override { return total; }
+  virtual bool rewind() override { return !started; }
+
+protected:
+  HTTPBodyProducer producer;
+  long int total;
+  bool started = false;
+};
+
+
+
+// A Stream read until it has nothing left, sent chunked unless its length is given.
+// Without a length the body ends the first time the stream has nothing available, so use it for streams that are read from storage
+class HTTPStreamSource : public HTTPBodySource
+{
+public:
+  HTTPStreamSource(Stream& stream, long int length = -1) :
+    stream(stream), total(length) {}
+
+  virtual long int read(uint8_t* buffer, size_t capacity) override;
+  virtual long int length() const override { return total; }
+  virtual bool rewind() override { return position == 0; }
+
+protected:
+  Stream& stream;
+  long int total;
+  size_t position = 0;
+};
+
+
+
+// An open file (LittleFS, SPIFFS or SD), anything with read(buffer, length), size() and seek(position).
+// Blocks are read from the file straight into the client's transmit buffer
+template<typename FileType>
+class HTTPFileSource : public HTTPBodySource
+{
+public:
+  HTTPFileSource(FileType& file) :
+    file(file), total(file.size()) {}
+
+  virtual long int read(uint8_t* buffer, size_t capacity) override;
+  virtual long int length() const override { return total; }
+  virtual bool rewind() override { position = 0; return file.seek(0); }
+
+protected:
+  FileType& file;
+  long int total;
+  long int position = 0;
+};
+
+
+
+template<typename FileType>
+long int HTTPFileSource<FileType>::read(uint8_t* buffer, size_t capacity) {
+  if (position >= total) {
+    return HTTP_SOURCE_END;
+  }
+
+  if ((long int)capacity > total - position) {
+    capacity = total - position;
+  }
+
+  int n = file.read(buffer, capacity);
+
+  if (n <= 0) {
+    return HTTP_SOURCE_ERROR;
+  }
+
+  position += n;
+
+  return n;
+}
+
+
+
+#endif // HTTP_BODY_SOURCE_H
@@ -0,0 +1,143 @@
+#include "HTTPBufferPool.h"
+
+
+
+HTTPBufferPool::HTTPBufferPool(size_t bufferCount, size_t bufferSize) :
+  count((bufferCount < 0xFFFF) ? bufferCount : 0xFFFE),
+  size(bufferSize),
+  storage(new uint8_t[count * size]),
+  links(new std::atomic<uint16_t>[count])
+{
+  for (size_t i = count; i > 0; --i) {
+    push(i - 1);
+  }
+}
+
+
+
+HTTPBufferPool::~HTTPBufferPool()
+{
+  delete[] links;
+  delete[] storage;
+}
+
+
+
+HTTPBufferPool& HTTPBufferPool::shared() {
+  static HTTPBufferPool pool(HTTP_POOL_BUFFER_COUNT, HTTP_POOL_BUFFER_SIZE);
+
+  return pool;
+}
+
+
+
+bool HTTPBufferPool::pop(uint16_t& index) {
+  uint32_t head = top.load(std::memory_order_acquire);
+  uint32_t next;
+
+  do {
+    if ((head & 0xFFFF) == 0) {
+      return false;
+    }
+
+    next = ((head & 0xFFFF0000) + 0x10000) | links[(head & 0xFFFF) - 1].load(std::memory_order_relaxed);
+  } while (!top.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire));
+
+  index = (head & 0xFFFF) - 1;
+  return true;
+}
+
+
+
+void HTTPBufferPool::push(uint16_t index) {
+  uint32_t head = top.load(std::memory_order_relaxed);
+  uint32_t next;
+
+  do {
+    links[index].store(head & 0xFFFF, std::memory_order_relaxed);
+    next = ((head & 0xFFFF0000) + 0x10000) | (index + 1);
+  } while (!top.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+
+
+uint8_t* HTTPBufferPool::acquire() {
+  uint8_t* buffer = take();
+
+  if (buffer == nullptr) {
+    exhausted.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return buffer;
+}
+
+
+
+// The pool counts as exhausted once per call that found it empty, however long the wait for a buffer took
+uint8_t* HTTPBufferPool::acquire(unsigned long waitMs) {
+  uint8_t* buffer = take();
+  unsigned long start = millis();
+
+  if (buffer != nullptr) {
+    return buffer;
+  }
+
+  exhausted.fetch_add(1, std::memory_order_relaxed);
+
+  while (buffer == nullptr && millis() - start < waitMs) {
+    yield();
+
+    buffer = take();
+  }
+
+  if (buffer == nullptr) {
+    Serial.printf(F("[HTTPBufferPool] No buffer became free within %lu ms\n"), waitMs);
+  }
+
+  return buffer;
+}
+
+
+
+// Pops a free buffer and accounts for it, nullptr when there is none
+uint8_t* HTTPBufferPool::take() {
+  uint16_t index;
+
+  if (!pop(index)) {
+    return nullptr;
+  }
+
+  acquired.fetch_add(1, std::memory_order_relaxed);
+
+  size_t used = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+  size_t peak = highWater.load(std::memory_order_relaxed);
+  while (used > peak && !highWater.compare_exchange_weak(peak, used, std::memory_order_relaxed));
+
+  return storage + index * size;
+}
+
+
+
+void HTTPBufferPool::release(uint8_t* buffer) {
+  if (buffer == nullptr || buffer < storage || buffer >= storage + count * size) {
+    return;
+  }
+
+  inUse.fetch_sub(1, std::memory_order_relaxed);
+  push((buffer - storage) / size);
+}
+
+
+
+HTTPBufferPoolStats HTTPBufferPool::stats() const {
+  HTTPBufferPoolStats s;
+
+  s.bufferCount = count;
+  s.bufferSize = size;
+  s.inUse = inUse.load(std::memory_order_relaxed);
+  s.highWater = highWater.load(std::memory_order_relaxed);
+  s.acquired = acquired.load(std::memory_order_relaxed);
+  s.exhausted = exhausted.load(std::memory_order_relaxed);
+
+  return s;
+}
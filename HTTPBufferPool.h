@@ -0,0 +1,78 @@
+#ifndef HTTP_BUFFER_POOL_H
+#define HTTP_BUFFER_POOL_H
+
+
+
+#include <Arduino.h>
+
+#include <stdint.h>
+#include <atomic>
+
+
+
+// Geometry of the process wide pool returned by HTTPBufferPool::shared()
+#ifndef HTTP_POOL_BUFFER_COUNT
+#define HTTP_POOL_BUFFER_COUNT 8
+#endif
+
+#ifndef HTTP_POOL_BUFFER_SIZE
+#define HTTP_POOL_BUFFER_SIZE 1024
+#endif
+
+
+
+struct HTTPBufferPoolStats {
+  size_t bufferCount = 0;
+  size_t bufferSize = 0;
+  size_t inUse = 0;
+  size_t highWater = 0;      // most buffers ever in use at once
+  uint32_t acquired = 0;     // successful acquires
+  uint32_t exhausted = 0;    // acquires that found the pool empty, counted once whether or not they then got a buffer by waiting
+};
+
+
+
+// Fixed size I/O buffers shared between clients and pipeline stages.
+// All storage is allocated when the pool is constructed, acquire and release are lock-free and may be called from any task.
+class HTTPBufferPool
+{
+public:
+  HTTPBufferPool(size_t bufferCount, size_t bufferSize);
+  virtual ~HTTPBufferPool();
+
+  // The pool shared by every HTTPClient, created on first use
+  static HTTPBufferPool& shared();
+
+  // Returns nullptr immediately when the pool is exhausted
+  uint8_t* acquire();
+  // Waits upto waitMs for another task to release a buffer when the pool is exhausted
+  uint8_t* acquire(unsigned long waitMs);
+  void release(uint8_t* buffer);
+
+  size_t bufferSize() const { return size; }
+  size_t bufferCount() const { return count; }
+  HTTPBufferPoolStats stats() const;
+
+protected:
+  uint8_t* take();
+  bool pop(uint16_t& index);
+  void push(uint16_t index);
+
+protected:
+  size_t count;
+  size_t size;
+  uint8_t* storage;
+
+  // Treiber stack of free buffers, the low 16 bits hold index + 1 of the top buffer (0 when empty), the high 16 bits an ABA tag
+  std::atomic<uint32_t> top{0};
+  std::atomic<uint16_t>* links;
+
+  std::atomic<size_t> inUse{0};
+  std::atomic<size_t> highWater{0};
+  std::atomic<uint32_t> acquired{0};
+  std::atomic<uint32_t> exhausted{0};
+};
+
+
+
+#endif // HTTP_BUFFER_POOL_H
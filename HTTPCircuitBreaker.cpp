@@ -0,0 +1,107 @@
+#include "HTTPCircuitBreaker.h"
+
+
+
+HTTPCircuitBreaker::HTTPCircuitBreaker(uint16_t failureThreshold, unsigned long openDuration) :
+  failureThreshold((failureThreshold > 0) ? failureThreshold : 1),
+  openDuration(openDuration)
+{
+}
+
+
+
+HTTPCircuitState HTTPCircuitBreaker::state(uint32_t key) const {
+  const HTTPCircuitHost* host = find(key);
+
+  if (host == nullptr) {
+    return HTTPCircuitState::CircuitClosed;
+  }
+
+  // An open breaker turns half open on its own once the open duration has passed
+  if (host->state == HTTPCircuitState::CircuitOpen && millis() - host->openedAt >= openDuration) {
+    return HTTPCircuitState::CircuitHalfOpen;
+  }
+
+  return host->state;
+}
+
+
+
+bool HTTPCircuitBreaker::allowRequest(uint32_t key) {
+  HTTPCircuitHost& host = entry(key);
+
+  if (host.state == HTTPCircuitState::CircuitOpen && millis() - host.openedAt >= openDuration) {
+    Serial.println(F("[HTTPCircuitBreaker] Half open, letting a probe request through"));
+
+    host.state = HTTPCircuitState::CircuitHalfOpen;
+    host.probeInFlight = false;
+  }
+
+  switch (host.state) {
+    case HTTPCircuitState::CircuitClosed:
+      return true;
+
+    case HTTPCircuitState::CircuitHalfOpen:
+      if (!host.probeInFlight) {
+        host.probeInFlight = true;
+        return true;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  ++host.rejected;
+  return false;
+}
+
+
+
+void HTTPCircuitBreaker::recordSuccess(uint32_t key) {
+  HTTPCircuitHost& host = entry(key);
+
+  if (host.state != HTTPCircuitState::CircuitClosed) {
+    Serial.println(F("[HTTPCircuitBreaker] Host recovered, closing the breaker"));
+  }
+
+  host.state = HTTPCircuitState::CircuitClosed;
+  host.probeInFlight = false;
+  host.consecutiveFailures = 0;
+}
+
+
+
+void HTTPCircuitBreaker::recordFailure(uint32_t key) {
+  HTTPCircuitHost& host = entry(key);
+
+  if (host.consecutiveFailures < UINT16_MAX) {
+    ++host.consecutiveFailures;
+  }
+
+  // A failed probe reopens straight away
+  if (host.state == HTTPCircuitState::CircuitHalfOpen || (host.state == HTTPCircuitState::CircuitClosed && host.consecutiveFailures >= failureThreshold)) {
+    trip(host);
+  }
+}
+
+
+
+void HTTPCircuitBreaker::releaseProbe(uint32_t key) {
+  HTTPCircuitHost& host = entry(key);
+
+  if (host.state == HTTPCircuitState::CircuitHalfOpen) {
+    host.probeInFlight = false;
+  }
+}
+
+
+
+void HTTPCircuitBreaker::trip(HTTPCircuitHost& host) {
+  Serial.printf(F("[HTTPCircuitBreaker] Opening the breaker after %u consecutive failures\n"), (unsigned)host.consecutiveFailures);
+
+  host.state = HTTPCircuitState::CircuitOpen;
+  host.probeInFlight = false;
+  host.openedAt = millis();
+  ++host.opened;
+}
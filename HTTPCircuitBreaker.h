@@ -0,0 +1,76 @@
+#ifndef HTTP_CIRCUIT_BREAKER_H
+#define HTTP_CIRCUIT_BREAKER_H
+
+
+
+#include <Arduino.h>
+
+#include "HTTPRttEstimator.h"
+#include "HTTPHostTable.h"
+
+#include <stdint.h>
+
+
+
+// Number of hosts a breaker tracks before the least recently used one is forgotten
+#ifndef HTTP_BREAKER_MAX_HOSTS
+#define HTTP_BREAKER_MAX_HOSTS 8
+#endif
+
+
+
+typedef enum EHTTPCircuitState : uint8_t {
+  CircuitClosed,    // requests flow normally
+  CircuitOpen,      // requests fail fast until the open duration has passed
+  CircuitHalfOpen,  // a single probe request is let through to test the host
+} HTTPCircuitState;
+
+
+
+struct HTTPCircuitHost {
+  uint32_t key = 0;                 // hash of the hostname and port, 0 for an unused slot
+  uint32_t lastUsed = 0;
+  HTTPCircuitState state = HTTPCircuitState::CircuitClosed;
+  bool probeInFlight = false;
+  uint16_t consecutiveFailures = 0;
+  unsigned long openedAt = 0;
+  uint32_t opened = 0;              // times the breaker tripped
+  uint32_t rejected = 0;            // requests failed fast while open
+};
+
+
+
+// Stops paying full connect timeouts to a host that keeps failing.
+// Opens after failureThreshold consecutive failures, rejects requests for openDuration ms, then lets one probe through.
+// Not synchronised, share one between clients on different tasks only with your own locking.
+class HTTPCircuitBreaker
+{
+public:
+  HTTPCircuitBreaker(uint16_t failureThreshold = 5, unsigned long openDuration = 30000);
+
+  bool allowRequest(uint32_t key);
+  void recordSuccess(uint32_t key);
+  void recordFailure(uint32_t key);
+  // The probe ended without telling whether the host is back (e.g. it was cancelled), the next request probes instead
+  void releaseProbe(uint32_t key);
+
+  HTTPCircuitState state(uint32_t key) const;
+  HTTPCircuitState state(const char* hostname, uint16_t port) const
+    { return state(HTTPRttEstimator::hostKey(hostname, port)); }
+
+  // nullptr when the host has not been seen
+  const HTTPCircuitHost* find(uint32_t key) const { return hosts.find(key); }
+
+protected:
+  HTTPCircuitHost& entry(uint32_t key) { return hosts.entry(key); }
+  void trip(HTTPCircuitHost& host);
+
+protected:
+  HTTPHostTable<HTTPCircuitHost, HTTP_BREAKER_MAX_HOSTS> hosts;
+  uint16_t failureThreshold;
+  unsigned long openDuration;
+};
+
+
+
+#endif // HTTP_CIRCUIT_BREAKER_H
@@ -4,7 +4,8 @@
 
 HTTPClient::HTTPClient(Client &client, unsigned long timeout) :
   client(&client),
-  currentParsingConnection(std::make_shared<ConnectionInformation>())
+  currentParsingConnection(std::make_shared<ConnectionInformation>()),
+  timeout(timeout)
 {
   client.setTimeout(timeout);
 }
@@ -20,6 +21,10 @@ HTTPClient::~HTTPClient()
 
 void HTTPClient::close()
 {
+  rxStart = rxEnd = 0;
+  txLength = txSent = 0;
+  connectedKey = 0;
+
   if (client->connected())
   {
     client->stop();
@@ -28,9 +33,39 @@ void HTTPClient::close()
 
 
 
+// Case insensitive compare of a header field name against a lower case literal
+static bool headerNameEquals(const char* name, size_t length, const char* literal) {
+  size_t i = 0;
+
+  for (; i < length && literal[i] != '\0'; ++i) {
+    if (tolower((unsigned char)name[i]) != literal[i]) {
+      return false;
+    }
+  }
+
+  return i == length && literal[i] == '\0';
+}
+
+
+
+// Case insensitive check of a header value ending with a lower case literal
+static bool headerValueEndsWith(const char* value, size_t length, const char* literal) {
+  size_t n = strlen(literal);
+
+  if (n > length) {
+    return false;
+  }
+
+  return headerNameEquals(value + length - n, n, literal);
+}
+
+
+
 /**
- * @brief Sends an HTML request string to a given hostname.
+ * @brief Sends an HTML request string to a given hostname, retrying failed attempts according to the retry policy
+ * and following redirects when enabled.
  * NOTE: This opens a connection to the given host, and is cleaned up only on errors. You must handle closing the client after handling the body.
+ * A connection left open to the same host, whose last response was read in full, is reused instead of reconnecting.
  *
  * @param hostname The hostname to lookup
  * @param port The port to connect to
@@ -38,271 +73,2085 @@ void HTTPClient::close()
  * @param headers The HTML headers to send
  * @param timeout The timeout in milliseconds to wait for a response
  * @param outHeaders If not null, the parsed header lines will be pushed onto the back
+ * @param body If not null, sent after the headers with a Content-Length header
+ * @param bodyLength The length of body in bytes
  *
- * @return -1 on failure to connect to hostname
- * @return -2 on failure to send request to hostname
- * @return HTML Status code
+ * @return nullptr on failure to connect to or send the request to hostname
+ * @return The response of the last attempt, or of the last hop when following redirects
  */
 std::shared_ptr<ConnectionInformation> HTTPClient::sendHTMLRequest(
       const char* hostname,
       uint16_t port,
       const char* request,
       const char* inHeaders,
+      std::vector<String>* outHeaders,
+      const uint8_t* body,
+      size_t bodyLength) {
+  HTTPRequest parts;
+
+  parts.line = request;
+  parts.headers = inHeaders;
+  parts.headerSet = headerSet;
+  parts.body = body;
+  parts.bodyLength = (body != nullptr) ? bodyLength : 0;
+
+  return sendRequest(hostname, port, parts, outHeaders);
+}
+
+
+
+/**
+ * @brief Sends a request, following redirects as configured with setFollowRedirects.
+ *
+ * @param request What to send, updated for every redirect followed
+ *
+ * @return see sendHTMLRequest
+ */
+std::shared_ptr<ConnectionInformation> HTTPClient::sendRequest(
+      const char* hostname,
+      uint16_t port,
+      HTTPRequest request,
       std::vector<String>* outHeaders) {
-  Serial.printf(F("[HTTPClient]: Attemping to connect to %s:%hu\n"), hostname, port);
+  size_t headerCount = (outHeaders != nullptr) ? outHeaders->size() : 0;
+  std::shared_ptr<ConnectionInformation> result = sendWithRetries(hostname, port, request, outHeaders);
+
+  String host, line, method, path;    // only filled in once a redirect is followed, empty Strings allocate nothing
+  uint16_t status;
+  bool secure = request.secure || port == 443;
+
+  for (uint8_t hop = 0; hop < maxRedirects && result != nullptr; ++hop) {
+    status = result->return_status;
+
+    if ((status != 301 && status != 302 && status != 303 && status != 307 && status != 308) || result->location.length() == 0) {
+      break;
+    }
+
+    if (request.requestTemplate != nullptr) {
+      Serial.println(F("[HTTPClient] Not following the redirect of a templated request"));
+      break;
+    }
+
+    if (hop == 0) {
+      host = hostname;
+      line = request.line;
+    }
+
+    int methodEnd = line.indexOf(' ');
+    method = line.substring(0, methodEnd);
+    path = line.substring(methodEnd + 1, line.lastIndexOf(' '));
+
+    String nextHost = host;
+    uint16_t nextPort = port;
+    bool nextSecure = secure;
+
+    if (!resolveRedirect(result->location, nextSecure, nextHost, nextPort, path)) {
+      Serial.printf(F("[HTTPClient] Can not follow redirect to %s\n"), result->location.c_str());
+      break;
+    }
+
+    // The client is either a TLS client or a plain one, following would send plaintext to a https port or drop TLS
+    if (nextSecure != secure) {
+      Serial.printf(F("[HTTPClient] Not following redirect to %s, it changes the scheme\n"), result->location.c_str());
+      break;
+    }
+
+    // 303 always turns into a GET, 301 and 302 do for POST as every browser does, 307 and 308 keep the method
+    if ((status == 303 && method != "HEAD") || ((status == 301 || status == 302) && method == "POST")) {
+      method = "GET";
+      request.body = nullptr;
+      request.bodyLength = 0;
+      request.source = nullptr;
+    }
+
+    // Custom headers may carry credentials, they only follow redirects staying on the same host
+    bool sameHost = nextSecure == secure && nextHost.equalsIgnoreCase(host) && nextPort == port;
+    if (!sameHost) {
+      request.headers = nullptr;
+      request.headerSet = nullptr;
+    }
+
+    // Drain the redirect's body so a keep-alive connection to the same host can carry the next hop
+    if (!sameHost || !discardBody(cancelDrainLimit)) {
+      close();
+    }
+
+    if (outHeaders != nullptr) {
+      outHeaders->resize(headerCount);
+    }
+
+    host = nextHost;
+    port = nextPort;
+    line = method + " " + path + HTTP_VER_STR;
+    request.line = line.c_str();
+
+    Serial.printf(F("[HTTPClient] Following %hu redirect to %s:%hu%s\n"), status, host.c_str(), port, path.c_str());
+
+    result = sendWithRetries(host.c_str(), port, request, outHeaders);
+  }
+
+  return result;
+}
+
+
+
+/**
+ * @brief Sends a request to a URL, see sendHTMLRequest.
+ * Nothing is allocated to build the request, the URL is split in place and the request line composed in a stack buffer.
+ *
+ * @param method The request method, e.g. "GET"
+ * @param url An http:// or https:// URL, any fragment is dropped
+ * @param query If not null, parameters appended to the URL's own query
+ * @param inHeaders The HTML headers to send
+ * @param outHeaders If not null, the parsed header lines will be pushed onto the back
+ * @param body If not null, sent after the headers with a Content-Length header
+ * @param bodyLength The length of body in bytes
+ *
+ * @return nullptr if the URL is invalid or too long, otherwise as sendHTMLRequest
+ */
+std::shared_ptr<ConnectionInformation> HTTPClient::sendUrlRequest(
+      const char* method,
+      const char* url,
+      const HTTPQuery* query,
+      const char* inHeaders,
+      std::vector<String>* outHeaders,
+      const uint8_t* body,
+      size_t bodyLength) {
+  HTTPUrl parsed;
+  char host[HTTP_MAX_HOST_LENGTH + 1];
+  char line[HTTP_REQUEST_LINE_SIZE];
+  size_t length = 0;
+
+  if (!parsed.parse(url) || !parsed.host.copyTo(host, sizeof(host))) {
+    Serial.printf(F("[HTTPClient] Invalid URL %s\n"), url);
+    return nullptr;
+  }
+
+  static const char version[] = " HTTP/1.1";
+  size_t methodLength = strlen(method);
+  size_t pathLength = parsed.path.empty() ? 1 : parsed.path.length;
+  size_t queryLength = parsed.query.empty() ? 0 : parsed.query.length + 1;
+
+  if (methodLength + 1 + pathLength + queryLength + 1 + sizeof(version) > sizeof(line)) {
+    Serial.println(F("[HTTPClient] Request line too long"));
+    return nullptr;
+  }
+
+  memcpy(line, method, methodLength);
+  length += methodLength;
+  line[length++] = ' ';
+
+  memcpy(line + length, parsed.path.empty() ? "/" : parsed.path.data, pathLength);
+  length += pathLength;
+
+  if (queryLength > 0) {
+    line[length++] = '?';
+    memcpy(line + length, parsed.query.data, parsed.query.length);
+    length += parsed.query.length;
+  }
+
+  if (query != nullptr && query->size() > 0) {
+    line[length++] = (queryLength > 0) ? '&' : '?';
+
+    // Leave room for the version at the end
+    if (!query->appendTo(line, sizeof(line) - (sizeof(version) - 1), length)) {
+      Serial.println(F("[HTTPClient] Request line too long"));
+      return nullptr;
+    }
+  }
+
+  memcpy(line + length, version, sizeof(version));
+
+  HTTPRequest parts;
 
-  if (!client->connect(hostname, port)) {
-    Serial.printf(F("[HTTPClient]: Connection to %s:%hu failed\n"), hostname, port);
+  parts.line = line;
+  parts.headers = inHeaders;
+  parts.headerSet = headerSet;
+  parts.body = body;
+  parts.bodyLength = (body != nullptr) ? bodyLength : 0;
+  parts.secure = parsed.scheme.length == 5;   // parse only takes http and https
+
+  return sendRequest(host, parsed.port, parts, outHeaders);
+}
+
+
+
+/**
+ * @brief Sends a request built from a template, see HTTPRequestTemplate.
+ * The head is copied together from the template's literal runs and the values, and written with the body in as few writes as the transmit buffer allows.
+ *
+ * @param requestTemplate The template, it must outlive the request
+ * @param values The values of the {0} to {9} slots, at least requestTemplate.slots() of them
+ * @param body If not null, sent after the head, its length fills the {len} slot
+ * @param outHeaders If not null, the parsed header lines will be pushed onto the back
+ *
+ * @return nullptr if the template is invalid or values are missing, otherwise as sendHTMLRequest
+ */
+std::shared_ptr<ConnectionInformation> HTTPClient::http_send(
+      const char* hostname,
+      uint16_t port,
+      const HTTPRequestTemplate& requestTemplate,
+      const char* const* values,
+      size_t valueCount,
+      const uint8_t* body,
+      size_t bodyLength,
+      std::vector<String>* outHeaders) {
+  if (!requestTemplate.valid() || valueCount < requestTemplate.slots() || (values == nullptr && requestTemplate.slots() > 0)) {
+    Serial.println(F("[HTTPClient] Invalid request template or missing values"));
     return nullptr;
   }
 
-  Serial.printf(F("[HTTPClient]: Connected to %s:%hu\n"), hostname, port);
-  Serial.printf(F("[HTTPClient]: Sending Request\n    %s\n"), request);
+  // A line break in a value would end its line early, letting it add headers or split the request
+  for (size_t i = 0; i < requestTemplate.slots(); ++i) {
+    if (values[i] != nullptr && strpbrk(values[i], "\r\n") != nullptr) {
+      Serial.printf(F("[HTTPClient] Refusing the malformed value of slot %u\n"), (unsigned)i);
+      return nullptr;
+    }
+  }
+
+  HTTPRequest request;
 
-  // Send our request to the server, and set required headers
-  client->println(request);
-  client->printf(F("Host: %s:%hu\r\n"), hostname, port);
+  request.requestTemplate = &requestTemplate;
+  request.headerSet = headerSet;
+  request.values = values;
+  request.valueCount = valueCount;
+  request.body = body;
+  request.bodyLength = (body != nullptr) ? bodyLength : 0;
 
-  // Send any valid headers passed in
-  if (inHeaders != nullptr && inHeaders[0] != '\0') {
-    client->println(*inHeaders);
+  return sendRequest(hostname, port, request, outHeaders);
+}
+
+
+
+/**
+ * @brief Uploads a body pulled from source, see sendHTMLRequest.
+ * The source is read one transmit buffer at a time, sent with Content-Length when its length is known and chunked otherwise.
+ * Failed attempts and redirects keeping the method are only sent again if the source can rewind.
+ *
+ * @param request The request line, e.g. MAKE_PUT("/logs/today")
+ * @param source The body, it must outlive the request
+ *
+ * @return see sendHTMLRequest
+ */
+std::shared_ptr<ConnectionInformation> HTTPClient::http_upload(
+      const char* hostname,
+      uint16_t port,
+      const char* request,
+      const char* inHeaders,
+      HTTPBodySource& source,
+      std::vector<String>* outHeaders) {
+  HTTPRequest parts;
+
+  parts.line = request;
+  parts.headers = inHeaders;
+  parts.headerSet = headerSet;
+  parts.source = &source;
+
+  return sendRequest(hostname, port, parts, outHeaders);
+}
+
+
+
+/**
+ * @brief Connects and queues the head of an upload, the body is sent by pollUpload.
+ * A fresh connection is always opened, a body being streamed can not be sent again should a kept connection turn out to be closed.
+ *
+ * @param request The request line, e.g. MAKE_POST("/logs")
+ * @param source The body, it must outlive the upload
+ *
+ * @return false if another upload is in progress, or connecting or queueing the head failed
+ */
+bool HTTPClient::beginUpload(const char* hostname, uint16_t port, const char* request, const char* inHeaders, HTTPBodySource& source) {
+  HTTPRequest parts;
+  bool reused;
+
+  if (uploadState == HTTPUploadStatus::UploadSending) {
+    Serial.println(F("[HTTPClient]: An upload is already in progress"));
+    return false;
   }
 
-  // Finalize the request and ensure it was received
-  if (client->println() == 0) {
+  if (isCancelled()) {
+    Serial.println(F("[HTTPClient]: Request cancelled"));
+    return false;
+  }
+
+  parts.line = request;
+  parts.headers = inHeaders;
+  parts.headerSet = headerSet;
+  parts.source = &source;
+
+  uploadState = HTTPUploadStatus::UploadFailed;
+
+  if (!openConnection(hostname, port, false, reused)) {
+    return false;
+  }
+
+  if (!writeRequest(hostname, port, parts, false)) {
     Serial.printf(F("[HTTPClient]: Failed to send request to %s:%hu\n"), hostname, port);
 
     close();
+    return false;
+  }
+
+  return true;
+}
+
+
+
+/**
+ * @brief Reads the response of an upload pollUpload reported complete.
+ *
+ * @return nullptr if the upload did not complete, otherwise see sendHTMLRequest
+ */
+std::shared_ptr<ConnectionInformation> HTTPClient::finishUpload(std::vector<String>* outHeaders) {
+  if (uploadState != HTTPUploadStatus::UploadComplete) {
     return nullptr;
   }
 
-  delay(2); // Wait a moment such that the client has time to process our request
+  uploadState = HTTPUploadStatus::UploadIdle;
+  requestSentAt = millis();
 
-  // Return the http response code from the server
   return readResponseStatus(outHeaders);
 }
 
 
 
-// Reads the status line from the HTTP response, optionally returning the parsed headers if there is a vector allocated for it
-std::shared_ptr<ConnectionInformation> HTTPClient::readResponseStatus(std::vector<String>* outHeaders) {
-  String status;
+// Resets the upload state for streaming source after the head already in the transmit buffer
+void HTTPClient::startUpload(HTTPBodySource* source) {
+  uploadSource = source;
+  uploadLength = source->length();
+  uploadChunked = uploadLength < 0;
+  uploadEnded = false;
+  uploadBytes = 0;
+  uploadBlock = 0;
+  txSent = 0;
+  uploadState = HTTPUploadStatus::UploadSending;
+  uploadLastProgress = millis();
 
-  // Ignore all empty lines before the response line, damn webservers not adhering to the standard!
-  while (client->connected() && (status = client->readStringUntil('\r').trim()).length() == 0);
+  // A fresh connection has room in its send buffer, a transport reporting none does not implement availableForWrite
+  uploadBlocking = client->availableForWrite() <= 0;
+}
 
-  client->read();    // discard \n
 
-  Serial.printf(F("[HTTPClient] Recieved response status: %s\n"), status.c_str());
 
-  sscanf(status.c_str(), "%*s %hu %*s", &currentParsingConnection->return_status);
+/**
+ * @brief Writes as much of the upload as the transport takes without blocking, refilling the transmit buffer from the source.
+ * Chunked bodies are framed in place, the chunk size line is written into room left at the front of the buffer.
+ *
+ * @return UploadSending while there is more to write, UploadComplete once all of it was written, UploadFailed
+ */
+HTTPUploadStatus HTTPClient::pumpUpload() {
+  // Room for the longest chunk size line in front of a block and the CRLF after it
+  static const size_t chunkHead = 2 * sizeof(size_t) + 2;
+  char sizeLine[chunkHead + 1];
+  long int r;
+  size_t n;
+  int space;
+
+  if (uploadState != HTTPUploadStatus::UploadSending) {
+    return uploadState;
+  }
 
-  return readHeaders(currentParsingConnection, outHeaders);
-}
+  if (isCancelled()) {
+    Serial.println(F("[HTTPClient]: Upload cancelled"));
+    return failUpload();
+  }
 
+  for (;;) {
+    if (txSent < txLength) {
+      n = txLength - txSent;
 
+      if (!uploadBlocking) {
+        space = client->availableForWrite();
 
-// param outHeaders - Optionally 
-// returns ConnectionInformation& a reference to the current connection state
-std::shared_ptr<ConnectionInformation>& HTTPClient::readHeaders(std::shared_ptr<ConnectionInformation>& connection, std::vector<String>* outHeaders) {
-  Serial.println("[HTTPClient] Parsing headers...");
-  connection->encoding = HTTPTransferEncoding::None;
+        if (space <= 0) {
+          if (!client->connected()) {
+            Serial.println(F("[HTTPClient]: Connection closed during the upload"));
+            return failUpload();
+          }
+          break;
+        }
 
-  // Read size
-  const int BUF_SIZE = HEADER_READ_BUFFER_SIZE;
+        if ((size_t)space < n) {
+          n = space;
+        }
+      }
 
-  String header, lower;
-  
-  while ( (header = client->readStringUntil('\r', BUF_SIZE)).length() > 0) {
-    client->read(); // Discard \n
+      n = client->write(txBuffer + txSent, n);
+      requestWritten = requestWritten || n > 0;
 
-    if (outHeaders != nullptr) {
-      outHeaders->push_back(header);
-    }
+      if (n == 0) {
+        Serial.println(F("[HTTPClient]: Failed to write the upload"));
+        return failUpload();
+      }
 
-    Serial.printf(F("Header --- %s\n"), header.c_str());
+      txSent += n;
+      uploadLastProgress = millis();
+      continue;
+    }
 
-    lower = header;
-    lower.toLowerCase();
+    // The transmit buffer went out in full, count the body it held
+    if (uploadBlock > 0) {
+      uploadBytes += uploadBlock;
+      uploadBlock = 0;
 
-    if (connection->encoding == HTTPTransferEncoding::None) {
-      if (lower.startsWith(F("transfer-encoding"))) {
-        Serial.println(F("[HTTPClient] message has special encoding"));
-        if (lower.endsWith(F("chunked"))) { connection->encoding = HTTPTransferEncoding::Chunked; }
-        else if (lower.endsWith(F("compress"))) { connection->encoding = HTTPTransferEncoding::Compress; }
-        else if (lower.endsWith(F("deflate"))) { connection->encoding = HTTPTransferEncoding::Deflate; }
-        else if (lower.endsWith(F("gzip"))) { connection->encoding = HTTPTransferEncoding::GZip; }
-      } else if (lower.startsWith(F("content-length"))) {
-        int k = lower.indexOf(' ');
-        connection->chunkSize = strtoul((const char*)(header.c_str() + k + 1), nullptr, 10);
-        Serial.printf(F("[HTTPClient] No chunked encoding, content length is %lu bytes\n"), connection->chunkSize);
+      if (uploadProgress) {
+        uploadProgress(uploadBytes, uploadLength);
       }
     }
-  }
 
-  Serial.println(F("[HTTPClient] Finished Parsing headers"));
+    if (uploadEnded) {
+      uploadState = HTTPUploadStatus::UploadComplete;
+      return uploadState;
+    }
 
-  return connection;
-}
+    txSent = txLength = 0;
 
+    if (uploadChunked) {
+      r = uploadSource->read(txBuffer + chunkHead, sizeof(txBuffer) - chunkHead - 2);
+    } else {
+      r = uploadSource->read(txBuffer, sizeof(txBuffer));
+    }
 
+    // Waiting on a source with nothing ready yet is not a stalled connection
+    if (r == 0) {
+      uploadLastProgress = millis();
+      break;
+    }
 
-/// <summary>
-/// Streams the entire HTTP response body into the provided buffer in bufferSize chunks, calling the writeCallback function anytime at least 1 byte was read
-/// </summary>
-/// <param name="buffer">User provided buffer to stream data into</param>
-/// <param name="bufferSize">the size of the buffer</param>
-/// <param name="writeCallback">Callback invoked when bytes are read into the buffer</param>
-/// <returns>The total number of bytes processed</returns>
-long int HTTPClient::readBody(uint8_t* buffer, size_t bufferSize, std::function<bool(uint8_t *buffer, size_t dataSize)> writeCallback) {
-  static size_t r;
-  size_t total = 0;
+    if (r == HTTP_SOURCE_END) {
+      uploadEnded = true;
 
-  // continue reading while we're expecting more data
-  do {
-    r = readBytes((char*)buffer, bufferSize);
-    total += r;
+      if (uploadChunked) {
+        memcpy(txBuffer, "0\r\n\r\n", 5);
+        txLength = 5;
+      } else if ((long int)uploadBytes != uploadLength) {
+        Serial.printf(F("[HTTPClient]: Body source ended after %lu of %ld bytes\n"), (unsigned long)uploadBytes, uploadLength);
+        return failUpload();
+      }
+      continue;
+    }
 
-    Serial.printf(F("[HTTPClient] successfully read %ld bytes\n"), r);
+    if (r < 0 || (!uploadChunked && (long int)uploadBytes + r > uploadLength)) {
+      Serial.println(F("[HTTPClient]: Body source failed or is longer than its length"));
+      return failUpload();
+    }
 
-    if (!writeCallback(buffer, r)) {
-      Serial.println(F("[HTTPClient] Write callback failed"));
-      return -1;
+    if (uploadChunked) {
+      n = snprintf(sizeLine, sizeof(sizeLine), "%lX\r\n", (unsigned long)r);
+      txSent = chunkHead - n;
+      memcpy(txBuffer + txSent, sizeLine, n);
+      txBuffer[chunkHead + r] = '\r';
+      txBuffer[chunkHead + r + 1] = '\n';
+      txLength = chunkHead + r + 2;
+    } else {
+      txLength = r;
     }
-  } while (r == bufferSize);
 
-  return total;
-}
+    uploadBlock = r;
+  }
 
+  // A connection that takes nothing for longer than the idle deadline (or the timeout) has stalled
+  if (millis() - uploadLastProgress >= (deadlines.idle != 0 ? deadlines.idle : timeout)) {
+    Serial.println(F("[HTTPClient]: Upload stalled"));
 
+    lastTimeoutReason = HTTPTimeoutReason::TimeoutIdle;
+    return failUpload();
+  }
 
-long int HTTPClient::readBody(uint8_t* buffer, size_t bufferSize, HTTP_WRITE_CALLBACK writeCallback) {
-  return readBody(buffer, bufferSize, std::bind(writeCallback, std::placeholders::_1, std::placeholders::_2));
+  return uploadState;
 }
 
 
 
-long int HTTPClient::readBody(String& body, size_t maxCharacters) {
-  static size_t n;
-
-  n = body.length();
-  body = client->readString(maxCharacters);
+HTTPUploadStatus HTTPClient::failUpload() {
+  close();
 
-  return body.length() - n;
+  uploadState = HTTPUploadStatus::UploadFailed;
+  return uploadState;
 }
 
 
 
-// Read a single byte from the http stream
-int HTTPClient::read() {
-  static int a;
+/**
+ * @brief Resolves a Location header against the current request target.
+ * Handles absolute (http and https) and scheme relative URLs, absolute paths and relative paths, dropping any fragment.
+ *
+ * @param location The Location header's value
+ * @param secure In: whether the current request is https, out: whether the redirect is
+ * @param host In: the current host, out: the host to redirect to
+ * @param port In: the current port, out: the port to redirect to
+ * @param path In: the current path, out: the path (and query) to redirect to
+ *
+ * @return false if the location can not be followed
+ */
+bool HTTPClient::resolveRedirect(const String& location, bool& secure, String& host, uint16_t& port, String& path) {
+  String target = location;
 
-  if (currentParsingConnection->chunkSize == 0 && currentParsingConnection->encoding == EHTTPTransferEncoding::Chunked) {
-    currentParsingConnection->chunkSize = readChunkedDataSize();
+  int fragment = target.indexOf('#');
+  if (fragment >= 0) {
+    target = target.substring(0, fragment);
+  }
 
-    // We're at the end of our data, finish off reading it, and return -1 as required
-    if (currentParsingConnection->chunkSize == 0) {
-      Serial.println(F("[HTTPClient] Read: EOF"));
-      client->read(); // discard \r
-      client->read(); // discard \n
+  int authority = -1;
+  uint16_t defaultPort = port;
+
+  if (target.startsWith(F("http://"))) {
+    authority = 7;
+    defaultPort = 80;
+    secure = false;
+  } else if (target.startsWith(F("https://"))) {
+    authority = 8;
+    defaultPort = 443;
+    secure = true;
+  } else if (target.startsWith(F("//"))) {
+    authority = 2;
+  } else if (target.indexOf(F("://")) >= 0) {
+    return false;   // some other scheme
+  }
 
-      return -1;
+  if (authority >= 0) {
+    int pathStart = target.indexOf('/', authority);
+    int queryStart = target.indexOf('?', authority);
+    if (queryStart >= 0 && (pathStart < 0 || queryStart < pathStart)) {
+      pathStart = queryStart;
     }
-  }
 
-  if ( (a = client->read()) > 0) {
-    --currentParsingConnection->chunkSize;
-  }
+    String hostPort = (pathStart < 0) ? target.substring(authority) : target.substring(authority, pathStart);
+    int colon = hostPort.lastIndexOf(':');
 
-  return a;
-}
+    // An IPv6 literal loses its brackets, the colons inside them are not the port's
+    if (hostPort.startsWith(F("["))) {
+      int close = hostPort.indexOf(']');
 
+      if (close < 0 || (close + 1 < (int)hostPort.length() && hostPort[close + 1] != ':')) {
+        return false;
+      }
 
+      host = hostPort.substring(1, close);
+      port = (close + 1 < (int)hostPort.length()) ? strtoul(hostPort.c_str() + close + 2, nullptr, 10) : defaultPort;
+    } else if (colon >= 0) {
+      host = hostPort.substring(0, colon);
+      port = strtoul(hostPort.c_str() + colon + 1, nullptr, 10);
+    } else {
+      host = hostPort;
+      port = defaultPort;
+    }
 
-/// <summary>
-/// Reads bytes from the http body stream for the currently open client
-/// </summary>
-/// <param name="buffer">A pointer to a buffer that is at least length bytes long</param>
-/// <param name="length">The number of bytes to read from the HTTP stream</param>
-/// <returns>The number of bytes read into buffer</returns>
-size_t HTTPClient::readBytes(char* buffer, size_t length) {
-  // Quick shortcircuit for reuqests smaller than current chunk size
-  if (length <= currentParsingConnection->chunkSize) {
-    currentParsingConnection->chunkSize -= length;
-    return client->readBytes(buffer, length);
+    path = (pathStart < 0) ? String("/") : target.substring(pathStart);
+    if (path[0] == '?') {
+      path = String("/") + path;
+    }
+  } else if (target.startsWith(F("/"))) {
+    path = target;
+  } else if (target.startsWith(F("?"))) {
+    int query = path.indexOf('?');
+    path = ((query < 0) ? path : path.substring(0, query)) + target;
+  } else {
+    // Relative to the directory of the current path
+    int query = path.indexOf('?');
+    String base = (query < 0) ? path : path.substring(0, query);
+    path = base.substring(0, base.lastIndexOf('/') + 1) + target;
   }
 
-  size_t len = length;  // How much we have left we want to read into the buffer
-  size_t readSize, r;
+  if (host.length() == 0 || port == 0) {
+    return false;
+  }
 
-  // We're going to hit a chunk size boundary at least once for the given request that we'll need to parse
-  while (len > 0) {
-    // Read the rest of len, or read upto the chunk boundary
-    readSize = (len < currentParsingConnection->chunkSize) ? len : currentParsingConnection->chunkSize;
+  removeDotSegments(path);
 
-    r = client->readBytes(buffer + (length - len), readSize);
+  return true;
+}
 
-    len -= r;
-    currentParsingConnection->chunkSize -= r;
 
-    // We're at a chunk boundary, parse the stupid thing
-    if (currentParsingConnection->chunkSize == 0) {
-      if (currentParsingConnection->encoding == EHTTPTransferEncoding::Chunked) {
-        // A Boundary is formatted like:
-        // DATA1...\r\n
-        // CHUNKSIZE\r\n
-        // DATA2...\r\n
-        // so skip the \r\n after DATA_n
-        client->read();
-        client->read();
-
-        currentParsingConnection->chunkSize = readChunkedDataSize();
-
-        // The next chunk has a size of 0, this is the end of the body data
-        if (currentParsingConnection->chunkSize == 0) {
-          client->read();
-          client->read();
 
-          break;
-        }
+// Collapses "." and ".." segments of a path, leaving any query alone
+void HTTPClient::removeDotSegments(String& path) {
+  int query = path.indexOf('?');
+  String rest = (query < 0) ? path : path.substring(0, query);
+  String out;
+  int start = 1;
+  int end;
+
+  while (start <= (int)rest.length()) {
+    end = rest.indexOf('/', start);
+    if (end < 0) {
+      end = rest.length();
+    }
+
+    String segment = rest.substring(start, end);
+
+    if (segment == "..") {
+      int last = out.lastIndexOf('/');
+      out = (last < 0) ? String() : out.substring(0, last);
+      if (end == (int)rest.length()) {
+        out += '/';
       }
-      else {  // No special encoding, and we're done reading
-        break;
+    } else if (segment == ".") {
+      if (end == (int)rest.length()) {
+        out += '/';
       }
+    } else {
+      out += '/';
+      out += segment;
     }
+
+    start = end + 1;
   }
 
-  // do a quick calc instead of using another var
-  return length - len;
+  if (out.length() == 0) {
+    out = "/";
+  }
+
+  path = (query < 0) ? out : out + path.substring(query);
 }
 
 
 
-size_t HTTPClient::readChunkedDataSize() {
-  static char csBuf[9];
-  // Ensure we're at the start of our line
-  do {
-    csBuf[0] = client->read();
-  } while (csBuf[0] == '\n' || csBuf[0] == '\r');
+// Sends the request, retrying failed attempts according to the retry policy
+std::shared_ptr<ConnectionInformation> HTTPClient::sendWithRetries(
+      const char* hostname,
+      uint16_t port,
+      const HTTPRequest& request,
+      std::vector<String>* outHeaders) {
+  std::shared_ptr<ConnectionInformation> result;
+  size_t headerCount = (outHeaders != nullptr) ? outHeaders->size() : 0;
+  uint8_t attempts = (retryPolicy.maxAttempts > 0) ? retryPolicy.maxAttempts : 1;
+  unsigned long wait, start;
+  uint32_t key = HTTPRttEstimator::hostKey(hostname, port);
+  bool probe;
 
-  // read in the chunk size, a hex formatted number
-  client->readBytesUntil('\r', csBuf+1, 8);
-  client->read(); // discard \n
+  circuitRejected = false;
 
-  return strtoul(csBuf, nullptr, 16);
-}
+  for (uint8_t attempt = 1; ; ++attempt) {
+    // A request let through while the breaker is not closed is its probe
+    probe = circuitBreaker != nullptr && circuitBreaker->state(key) != HTTPCircuitState::CircuitClosed;
+
+    // Fail fast while the host's breaker is open, there is no point retrying either
+    if (circuitBreaker != nullptr && !circuitBreaker->allowRequest(key)) {
+      Serial.printf(F("[HTTPClient]: Circuit to %s:%hu is open, failing fast\n"), hostname, port);
 
+      circuitRejected = true;
+      return nullptr;
+    }
 
+    result = sendRequestAttempt(hostname, port, request, outHeaders);
 
-bool HTTPClient::readBody(DynamicJsonDocument& outDoc) {
-  if (currentParsingConnection->encoding == HTTPTransferEncoding::Chunked) {
-    currentParsingConnection->chunkSize = readChunkedDataSize();
-  }
+    // A cancelled request says nothing about the host, but a cancelled probe has to make way for the next one
+    if (circuitBreaker != nullptr && isCancelled()) {
+      if (probe) {
+        circuitBreaker->releaseProbe(key);
+      }
+    } else if (circuitBreaker != nullptr) {
+      if (result == nullptr || result->return_status == 0 || result->return_status >= 500) {
+        circuitBreaker->recordFailure(key);
+      } else {
+        circuitBreaker->recordSuccess(key);
+      }
+    }
+
+    if (attempt >= attempts || isCancelled() || !shouldRetry(result) || !mayRepeat(request)) {
+      return result;
+    }
 
+    wait = retryDelay(attempt, result);
+
+    if (wait > retryPolicy.maxDelay) {
+      Serial.printf(F("[HTTPClient] Server asked to retry after %lu ms, longer than the retry policy allows\n"), wait);
+      return result;
+    }
+
+    // Drop the failed response, keeping the connection when what is left of it is small enough to drain
+    if (result != nullptr && !discardBody(cancelDrainLimit)) {
+      close();
+    }
+
+    if (outHeaders != nullptr) {
+      outHeaders->resize(headerCount);
+    }
+
+    Serial.printf(F("[HTTPClient] Retrying in %lu ms (attempt %u of %u)\n"), wait, (unsigned)(attempt + 1), (unsigned)attempts);
+
+    start = millis();
+    while (millis() - start < wait && !isCancelled()) {
+      delay(1);
+    }
+  }
+}
+
+
+
+// Sends the request once, reusing the open connection when it is to the same host and ready for another request
+std::shared_ptr<ConnectionInformation> HTTPClient::sendRequestAttempt(
+      const char* hostname,
+      uint16_t port,
+      const HTTPRequest& request,
+      std::vector<String>* outHeaders) {
+  std::shared_ptr<ConnectionInformation> result;
+  bool reused;
+
+  // A reused connection the server closed while it was idle gets one fresh connection, never more
+  for (uint8_t tries = 0; ; ++tries) {
+    if (isCancelled()) {
+      Serial.println(F("[HTTPClient]: Request cancelled"));
+      return nullptr;
+    }
+
+    if (!openConnection(hostname, port, tries == 0, reused)) {
+      return nullptr;
+    }
+
+    if (!writeRequest(hostname, port, request)) {
+      Serial.printf(F("[HTTPClient]: Failed to send request to %s:%hu\n"), hostname, port);
+
+      close();
+
+      // Once part of it went out the server may have acted on it, only requests that may be repeated are sent again
+      if (reused && (!requestWritten || mayRepeat(request))) {
+        continue;
+      }
+
+      return nullptr;
+    }
+
+    requestSentAt = millis();
+
+    delay(2); // Wait a moment such that the client has time to process our request
+
+    // Return the http response code from the server
+    result = readResponseStatus(outHeaders);
+
+    // The server may have closed an idle keep-alive connection just before we used it, that deserves a fresh connection
+    if (reused && result->return_status == 0 && !client->connected() && mayRepeat(request)) {
+      Serial.println(F("[HTTPClient]: Reused connection was closed by the server, reconnecting"));
+
+      close();
+      continue;
+    }
+
+    break;
+  }
+
+  // The server still expects the body it refused, the connection can not carry another request
+  if (bodyWithheld) {
+    result->keepAlive = false;
+  }
+
+  return result;
+}
+
+
+
+// True if sending the request again is safe: its method is idempotent, or the retry policy allows any, and its body can be replayed
+bool HTTPClient::mayRepeat(const HTTPRequest& request) {
+  bool idempotent = retryPolicy.retryNonIdempotent
+    || ((request.requestTemplate != nullptr) ? request.requestTemplate->idempotent() : isIdempotent(request.line));
+
+  return idempotent && (request.source == nullptr || request.source->rewind());
+}
+
+
+
+// Connects to the host, or keeps the open connection when allowed and it is to the same host and ready for another request
+bool HTTPClient::openConnection(const char* hostname, uint16_t port, bool allowReuse, bool& reused) {
+  uint32_t key = HTTPRttEstimator::hostKey(hostname, port);
+  reused = allowReuse && connectedKey == key && currentParsingConnection->keepAlive && currentParsingConnection->bodyComplete
+    && rxStart == rxEnd && client->connected();
+
+  lastTimeoutReason = HTTPTimeoutReason::TimeoutNone;
+  rttKey = key;
+
+  if (reused) {
+    Serial.printf(F("[HTTPClient]: Reusing the connection to %s:%hu\n"), hostname, port);
+  } else {
+    Serial.printf(F("[HTTPClient]: Attemping to connect to %s:%hu\n"), hostname, port);
+
+    // Anything left over from a previous connection is meaningless now
+    close();
+
+    // Without an explicit connect deadline one is derived from the host's measured round trip times, once there are some
+    unsigned long connectLimit = deadlines.connect;
+
+    if (connectLimit == 0 && rttEstimator != nullptr) {
+      connectLimit = rttEstimator->connectTimeout(rttKey);
+    }
+
+    // Clients whose connect honours the stream timeout (e.g. ESP32 WiFiClient) are held to the connect deadline
+    if (connectLimit != 0) {
+      client->setTimeout(connectLimit);
+    }
+
+    unsigned long connectStart = millis();
+    int connected = client->connect(hostname, port);
+    unsigned long connectTime = millis() - connectStart;
+
+    if (connectLimit != 0) {
+      client->setTimeout(timeout);
+    }
+
+    if (!connected) {
+      if (connectLimit != 0 && connectTime >= connectLimit) {
+        lastTimeoutReason = HTTPTimeoutReason::TimeoutConnect;
+
+        if (rttEstimator != nullptr) {
+          rttEstimator->connectTimedOut(rttKey);
+        }
+      }
+
+      Serial.printf(F("[HTTPClient]: Connection to %s:%hu failed\n"), hostname, port);
+      return false;
+    }
+
+    if (rttEstimator != nullptr) {
+      rttEstimator->sampleConnect(rttKey, connectTime);
+    }
+
+    connectedKey = key;
+
+    Serial.printf(F("[HTTPClient]: Connected to %s:%hu\n"), hostname, port);
+  }
+
+  return true;
+}
+
+
+
+// Adds a segment to a gather list, false when the list is full
+static bool gather(HTTPIoVec* vec, size_t& count, const void* data, size_t length, bool flash = false) {
+  if (length == 0) {
+    return true;
+  }
+
+  if (count == HTTP_IOVEC_MAX) {
+    return false;
+  }
+
+  vec[count].data = data;
+  vec[count].length = length;
+  vec[count].flash = flash;
+  ++count;
+
+  return true;
+}
+
+
+
+// Adds the blocks of the sets the header set extends, then its own
+static bool gatherHeaderSet(HTTPIoVec* vec, size_t& count, const HTTPHeaderSet* headers) {
+  if (headers == nullptr) {
+    return true;
+  }
+
+  return gatherHeaderSet(vec, count, headers->base()) && gather(vec, count, headers->data(), headers->length());
+}
+
+
+
+/**
+ * @brief Collects the request line, headers and body into a gather list and submits it as one write.
+ * A body source is streamed after the head, when flush is false only the head is queued in the transmit buffer and pumpUpload sends the rest.
+ *
+ * @return false if the connection would not take it
+ */
+bool HTTPClient::writeRequest(const char* hostname, uint16_t port, const HTTPRequest& request, bool flush) {
+  HTTPIoVec vec[HTTP_IOVEC_MAX];
+  size_t count = 0;
+  char hostPort[10];
+  char contentLength[40];
+  bool ok = true;
+  bool expect = flush && expectContinueTimeout != 0 && request.requestTemplate == nullptr
+    && (request.source != nullptr || request.bodyLength > 0);
+  size_t first = 0;
+
+  bodyWithheld = false;
+  requestWritten = false;
+  // The previous response's body deadline does not apply to this request's exchange
+  beginPhase(HTTPTimeoutReason::TimeoutNone, 0, 0);
+
+  // The template text may live in flash
+  const char* method = (request.requestTemplate != nullptr) ? request.requestTemplate->text() : request.line;
+  headRequest = true;
+
+  for (size_t i = 0; i < 5 && headRequest; ++i) {
+    headRequest = (char)pgm_read_byte(method + i) == "HEAD "[i];
+  }
+
+  snprintf(hostPort, sizeof(hostPort), ":%hu\r\n", port);
+
+  // An IPv6 literal is connected to as it is but keeps its brackets in the Host header
+  bool literal = strchr(hostname, ':') != nullptr;
+  size_t hostLength = strlen(hostname);
+
+  if (request.requestTemplate != nullptr) {
+    const HTTPRequestTemplate& requestTemplate = *request.requestTemplate;
+    const char* value;
+
+    Serial.println(F("[HTTPClient]: Sending templated request"));
+
+    snprintf(contentLength, sizeof(contentLength), "%lu", (unsigned long)request.bodyLength);
+
+    for (size_t i = 0; i < requestTemplate.size() && ok; ++i) {
+      const HTTPTemplateSegment& segment = requestTemplate.segment(i);
+
+      if (segment.slot == HTTP_TEMPLATE_SLOT_NONE) {
+        ok = gather(vec, count, requestTemplate.text() + segment.offset, segment.length, true);
+      } else {
+        value = (segment.slot == HTTP_TEMPLATE_SLOT_LENGTH) ? contentLength : request.values[segment.slot];
+        ok = value == nullptr || gather(vec, count, value, strlen(value));
+      }
+
+      // Host goes right after the request line
+      if (ok && i + 1 == requestTemplate.lineSegments()) {
+        ok = gather(vec, count, literal ? "Host: [" : "Host: ", literal ? 7 : 6) && gather(vec, count, hostname, hostLength)
+          && gather(vec, count, literal ? "]" : "", literal ? 1 : 0) && gather(vec, count, hostPort, strlen(hostPort));
+      }
+    }
+  } else {
+    Serial.printf(F("[HTTPClient]: Sending Request\n    %s\n"), request.line);
+
+    ok = gather(vec, count, request.line, strlen(request.line)) && gather(vec, count, literal ? "\r\nHost: [" : "\r\nHost: ", literal ? 9 : 8)
+      && gather(vec, count, hostname, hostLength) && gather(vec, count, literal ? "]" : "", literal ? 1 : 0) && gather(vec, count, hostPort, strlen(hostPort));
+
+    if (request.source != nullptr) {
+      if (!request.source->rewind()) {
+        Serial.println(F("[HTTPClient]: The body source can not be sent again"));
+        return false;
+      }
+
+      int n = (request.source->length() < 0) ? snprintf(contentLength, sizeof(contentLength), "Transfer-Encoding: chunked\r\n")
+        : snprintf(contentLength, sizeof(contentLength), "Content-Length: %ld\r\n", request.source->length());
+      ok = ok && gather(vec, count, contentLength, n);
+
+      if (request.source->contentEncoding() != nullptr) {
+        ok = ok && gather(vec, count, "Content-Encoding: ", 18)
+          && gather(vec, count, request.source->contentEncoding(), strlen(request.source->contentEncoding())) && gather(vec, count, "\r\n", 2);
+      }
+
+      if (request.source->contentType() != nullptr) {
+        ok = ok && gather(vec, count, "Content-Type: ", 14)
+          && gather(vec, count, request.source->contentType(), strlen(request.source->contentType())) && gather(vec, count, "\r\n", 2);
+      }
+    } else if (request.body != nullptr) {
+      int n = snprintf(contentLength, sizeof(contentLength), "Content-Length: %lu\r\n", (unsigned long)request.bodyLength);
+      ok = ok && gather(vec, count, contentLength, n);
+    }
+
+    if (expect) {
+      ok = ok && gather(vec, count, "Expect: 100-continue\r\n", 22);
+    }
+  }
+
+  ok = ok && gatherHeaderSet(vec, count, request.headerSet);
+
+  // Any valid headers passed in, adding the line ending of the last one if it was left off
+  if (ok && request.headers != nullptr && request.headers[0] != '\0') {
+    size_t length = strlen(request.headers);
+
+    ok = gather(vec, count, request.headers, length);
+
+    if (length < 2 || request.headers[length - 2] != '\r' || request.headers[length - 1] != '\n') {
+      ok = ok && gather(vec, count, "\r\n", 2);
+    }
+  }
+
+  ok = ok && gather(vec, count, "\r\n", 2);
+
+  size_t headCount = count;
+
+  ok = ok && gather(vec, count, request.body, request.bodyLength);
+
+  if (!ok) {
+    Serial.println(F("[HTTPClient]: Request has too many parts to send"));
+    return false;
+  }
+
+  // Send the head on its own and the body only once the server did not refuse the request
+  if (expect) {
+    if (!writeGathered(vec, headCount, true)) {
+      return false;
+    }
+
+    if (!awaitContinue()) {
+      Serial.println(F("[HTTPClient]: Server answered before the body, not sending it"));
+
+      bodyWithheld = true;
+      return true;
+    }
+
+    first = headCount;
+  }
+
+  if (request.source == nullptr) {
+    return writeGathered(vec + first, count - first, flush);
+  }
+
+  if (!writeGathered(vec + first, count - first, false)) {
+    return false;
+  }
+
+  startUpload(request.source);
+
+  if (!flush) {
+    return true;
+  }
+
+  HTTPUploadStatus status;
+
+  while ((status = pumpUpload()) == HTTPUploadStatus::UploadSending) {
+    delay(1);
+  }
+
+  uploadState = HTTPUploadStatus::UploadIdle;
+
+  return status == HTTPUploadStatus::UploadComplete;
+}
+
+
+
+/**
+ * @brief Waits upto the expect continue timeout for the server's answer to the head of a request sent with Expect: 100-continue.
+ * 100 Continue and any other interim response are consumed, a final response is left in the receive buffer for readResponseStatus.
+ * A server that does not answer in time may not know the expectation, the body is sent anyway.
+ *
+ * @return true if the body should be sent, false if the server answered with a final status or the connection closed
+ */
+bool HTTPClient::awaitContinue() {
+  unsigned long start = millis();
+  const uint8_t* eol;
+  uint16_t status;
+  String line;
+  char code[4];
+
+  for (;;) {
+    while (rxStart == rxEnd && client->available() <= 0) {
+      if (!client->connected() || isCancelled()) {
+        return false;
+      }
+
+      if (millis() - start >= expectContinueTimeout) {
+        Serial.println(F("[HTTPClient]: No answer to Expect: 100-continue, sending the body"));
+        return true;
+      }
+
+      yield();
+    }
+
+    // The status line must be buffered whole to look at its code without consuming it
+    while ((eol = httpFindCRLF(rxBuffer + rxStart, rxBuffer + rxEnd)) == rxBuffer + rxEnd) {
+      if (fillReceiveBuffer() == 0) {
+        return false;
+      }
+    }
+
+    if (eol == rxBuffer + rxStart) {
+      rxStart += 2;
+      continue;
+    }
+
+    // "HTTP/1.1 100 Continue", the code follows the first space
+    const uint8_t* space = httpFindByte(rxBuffer + rxStart, eol, ' ');
+    status = 0;
+
+    if (eol - space > 3) {
+      memcpy(code, space + 1, 3);
+      code[3] = '\0';
+      status = atoi(code);
+    }
+
+    if (status < 100 || status >= 200 || status == 101) {
+      return false;
+    }
+
+    // An interim response is a status line and headers without a body
+    while (readLine(line, HEADER_READ_BUFFER_SIZE) && line.length() > 0);
+
+    if (status == 100) {
+      return true;
+    }
+  }
+}
+
+
+
+/**
+ * @brief Submits a gather list as a single write.
+ * With a gather writer attached the list is handed to it (writev on a POSIX socket), otherwise the segments are coalesced
+ * in the transmit buffer, which is written once when it all fits and whenever it fills up otherwise.
+ * Without flush what fits is left in the transmit buffer, for an upload to send.
+ *
+ * @return false if the connection did not take everything
+ */
+bool HTTPClient::writeGathered(const HTTPIoVec* vec, size_t count, bool flush) {
+  bool ok = true;
+
+  if (gatherWriter != nullptr && flush) {
+    size_t total = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+      total += vec[i].length;
+    }
+
+    size_t written = gatherWriter->writeGathered(vec, count);
+    requestWritten = requestWritten || written > 0;
+
+    return written == total;
+  }
+
+  txLength = 0;
+
+  for (size_t i = 0; i < count && ok; ++i) {
+    ok = vec[i].flash ? txAppendFlash((const char*)vec[i].data, vec[i].length) : txAppend((const uint8_t*)vec[i].data, vec[i].length);
+  }
+
+  return (!flush || txFlush()) && ok;
+}
+
+
+
+// Only requests with an idempotent method are retried unless the retry policy says otherwise
+bool HTTPClient::isIdempotent(const char* request) {
+  static const char* const methods[] = { "GET ", "HEAD ", "PUT ", "DELETE ", "OPTIONS ", "TRACE " };
+
+  for (const char* method : methods) {
+    if (strncmp(request, method, strlen(method)) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+
+bool HTTPClient::shouldRetry(const std::shared_ptr<ConnectionInformation>& result) {
+  if (result == nullptr) {
+    return true;  // failed to connect or send
+  }
+
+  switch (result->return_status) {
+    case 0:     // no response in time
+    case 429:
+    case 500:
+    case 502:
+    case 503:
+    case 504:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+
+
+// Exponential backoff with jitter, half the delay is fixed and half random, stretched to the server's Retry-After if it asked for longer
+unsigned long HTTPClient::retryDelay(uint8_t attempt, const std::shared_ptr<ConnectionInformation>& result) {
+  unsigned long cap = retryPolicy.baseDelay;
+
+  for (uint8_t i = 1; i < attempt && cap < retryPolicy.maxDelay; ++i) {
+    cap *= 2;
+  }
+
+  if (cap > retryPolicy.maxDelay) {
+    cap = retryPolicy.maxDelay;
+  }
+
+  unsigned long wait = cap / 2 + random(cap / 2 + 1);
+
+  if (retryPolicy.respectRetryAfter && result != nullptr && result->retryAfter > wait) {
+    wait = result->retryAfter;
+  }
+
+  return wait;
+}
+
+
+
+// Reads the status line from the HTTP response, optionally returning the parsed headers if there is a vector allocated for it
+std::shared_ptr<ConnectionInformation> HTTPClient::readResponseStatus(std::vector<String>* outHeaders) {
+  String status;
+
+  // Every response gets its own state, so results handed out earlier are never modified underneath their owner
+  currentParsingConnection = std::make_shared<ConnectionInformation>();
+
+  // Wait for the server to start answering, then for the rest of the status line and headers
+  unsigned long firstByteLimit = deadlines.firstByte;
+
+  if (firstByteLimit == 0 && rttEstimator != nullptr) {
+    firstByteLimit = rttEstimator->firstByteTimeout(rttKey);
+  }
+
+  beginPhase(HTTPTimeoutReason::TimeoutFirstByte, requestSentAt, firstByteLimit);
+  if (rxStart == rxEnd) {
+    fillReceiveBuffer();
+  }
+
+  if (rttEstimator != nullptr) {
+    if (rxStart < rxEnd) {
+      rttEstimator->sampleFirstByte(rttKey, millis() - requestSentAt);
+    } else if (currentParsingConnection->timeoutReason == HTTPTimeoutReason::TimeoutFirstByte) {
+      rttEstimator->firstByteTimedOut(rttKey);
+    }
+  }
+
+  if (currentParsingConnection->timeoutReason != HTTPTimeoutReason::TimeoutNone) {
+    return currentParsingConnection;
+  }
+
+  beginPhase(HTTPTimeoutReason::TimeoutHeader, requestSentAt, deadlines.header);
+
+  for (;;) {
+    // Ignore all empty lines before the response line, damn webservers not adhering to the standard!
+    while (readLine(status, HEADER_READ_BUFFER_SIZE) && status.trim().length() == 0);
+
+    Serial.printf(F("[HTTPClient] Recieved response status: %s\n"), status.c_str());
+
+    currentParsingConnection->return_status = 0;
+    sscanf(status.c_str(), "%*s %hu %*s", &currentParsingConnection->return_status);
+
+    // Interim responses (100 Continue, 103 Early Hints) come before the final one, 101 Switching Protocols is final
+    uint16_t code = currentParsingConnection->return_status;
+
+    if (code < 100 || code >= 200 || code == 101) {
+      break;
+    }
+
+    size_t lines = 0;
+
+    while (readLine(status, HEADER_READ_BUFFER_SIZE) && status.length() > 0) {
+      if (++lines > HTTP_MAX_HEADER_LINES) {
+        return tooManyHeaders(currentParsingConnection);
+      }
+    }
+  }
+
+  // HTTP/1.0 servers close after every response unless they say otherwise
+  currentParsingConnection->keepAlive = !status.startsWith(F("HTTP/1.0"));
+
+  return readHeaders(currentParsingConnection, outHeaders);
+}
+
+
+
+// param outHeaders - Optionally 
+// returns ConnectionInformation& a reference to the current connection state
+std::shared_ptr<ConnectionInformation>& HTTPClient::readHeaders(std::shared_ptr<ConnectionInformation>& connection, std::vector<String>* outHeaders) {
+  Serial.println("[HTTPClient] Parsing headers...");
+  connection->encoding = HTTPTransferEncoding::None;
+  connection->chunkSize = 0;
+  connection->bodyComplete = false;
+
+  // Pull in as much of the header block as fits so the lines below are split in place
+  while (rxEnd - rxStart < 2 || rxBuffer[rxStart] != '\r' || rxBuffer[rxStart + 1] != '\n') {
+    if (httpFindHeaderEnd(rxBuffer + rxStart, rxBuffer + rxEnd) < rxBuffer + rxEnd || fillReceiveBuffer() == 0) {
+      break;
+    }
+  }
+
+  String header;
+  bool hasContentLength = false;
+  size_t lines = 0;
+  
+  while (readLine(header, HEADER_READ_BUFFER_SIZE) && header.length() > 0) {
+    if (++lines > HTTP_MAX_HEADER_LINES) {
+      return tooManyHeaders(connection);
+    }
+
+    if (outHeaders != nullptr) {
+      outHeaders->push_back(header);
+    }
+
+    Serial.printf(F("Header --- %s\n"), header.c_str());
+
+    const char* line = header.c_str();
+    const char* colon = (const char*)httpFindByte((const uint8_t*)line, (const uint8_t*)line + header.length(), ':');
+    size_t nameLength = colon - line;
+
+    if (nameLength == header.length()) {
+      continue;   // not a field, nothing for us to parse
+    }
+
+    const char* value = colon + 1;
+    while (*value == ' ' || *value == '\t') { ++value; }
+    size_t valueLength = header.length() - (value - line);
+
+    if (headerNameEquals(line, nameLength, "connection")) {
+      if (headerValueEndsWith(value, valueLength, "close")) { connection->keepAlive = false; }
+      else if (headerValueEndsWith(value, valueLength, "keep-alive")) { connection->keepAlive = true; }
+    } else if (headerNameEquals(line, nameLength, "location")) {
+      connection->location = value;
+    } else if (headerNameEquals(line, nameLength, "retry-after")) {
+      // Only the delay in seconds form, there is no clock to compare an HTTP date against
+      if (*value >= '0' && *value <= '9') {
+        connection->retryAfter = strtoul(value, nullptr, 10) * 1000;
+      }
+    }
+
+    if (connection->encoding == HTTPTransferEncoding::None) {
+      if (headerNameEquals(line, nameLength, "transfer-encoding")) {
+        Serial.println(F("[HTTPClient] message has special encoding"));
+        if (headerValueEndsWith(value, valueLength, "chunked")) { connection->encoding = HTTPTransferEncoding::Chunked; }
+        else if (headerValueEndsWith(value, valueLength, "compress")) { connection->encoding = HTTPTransferEncoding::Compress; }
+        else if (headerValueEndsWith(value, valueLength, "deflate")) { connection->encoding = HTTPTransferEncoding::Deflate; }
+        else if (headerValueEndsWith(value, valueLength, "gzip")) { connection->encoding = HTTPTransferEncoding::GZip; }
+      } else if (headerNameEquals(line, nameLength, "content-length")) {
+        connection->chunkSize = strtoul(value, nullptr, 10);
+        hasContentLength = true;
+        Serial.printf(F("[HTTPClient] No chunked encoding, content length is %lu bytes\n"), connection->chunkSize);
+      }
+    }
+  }
+
+  // Chunked bodies start with a chunk size line which is read on the first body access,
+  // without a length the body runs until the server closes the connection.
+  // Answers to HEAD, 204 and 304 never have a body whatever their headers say, after a 101 the connection belongs to the new protocol
+  uint16_t status = connection->return_status;
+
+  if (headRequest || status == 204 || status == 304 || (status >= 100 && status < 200 && status != 101)) {
+    connection->encoding = HTTPTransferEncoding::None;
+    connection->chunkSize = 0;
+    connection->bodyComplete = true;
+  } else if (status == 101) {
+    connection->encoding = HTTPTransferEncoding::None;
+    connection->chunkSize = SIZE_MAX;
+    connection->keepAlive = false;
+  } else if (connection->encoding == HTTPTransferEncoding::Chunked) {
+    connection->chunkSize = 0;
+  } else if (!hasContentLength) {
+    connection->chunkSize = SIZE_MAX;
+  } else if (connection->chunkSize == 0) {
+    connection->bodyComplete = true;
+  }
+
+  Serial.println(F("[HTTPClient] Finished Parsing headers"));
+
+  beginPhase(HTTPTimeoutReason::TimeoutBody, millis(), deadlines.body);
+
+  return connection;
+}
+
+
+
+/// <summary>
+/// Streams the entire HTTP response body into the provided buffer in bufferSize chunks, calling the writeCallback function anytime at least 1 byte was read
+/// </summary>
+/// <param name="buffer">User provided buffer to stream data into</param>
+/// <param name="bufferSize">the size of the buffer</param>
+/// <param name="writeCallback">Callback invoked when bytes are read into the buffer</param>
+/// <returns>The total number of bytes processed</returns>
+long int HTTPClient::readBody(uint8_t* buffer, size_t bufferSize, std::function<bool(uint8_t *buffer, size_t dataSize)> writeCallback) {
+  return streamBody(buffer, bufferSize, [writeCallback](uint8_t* data, size_t dataSize) {
+    return writeCallback(data, dataSize) ? HTTPCallbackResult::Continue : HTTPCallbackResult::Abort;
+  });
+}
+
+
+
+/// <summary>
+/// Streams the HTTP response body into the provided buffer in bufferSize chunks, like readBody, but lets the callback pause the read.
+/// While paused nothing more is pulled from the socket, unread data stays in the network stack's buffers and the connection is kept open.
+/// </summary>
+/// <param name="buffer">User provided buffer to stream data into, it must stay valid until the read completes</param>
+/// <param name="bufferSize">the size of the buffer</param>
+/// <param name="writeCallback">Callback invoked when bytes are read into the buffer, the data passed along with Pause has been consumed</param>
+/// <returns>The total number of bytes processed, -1 if the callback aborted or HTTP_BODY_PAUSED if it paused the read, HTTP_BODY_CANCELLED if the cancellation token fired</returns>
+long int HTTPClient::streamBody(uint8_t* buffer, size_t bufferSize, HTTPBodyCallback writeCallback) {
+  bodyBuffer = buffer;
+  bodyBufferSize = bufferSize;
+  bodyCallback = writeCallback;
+  bodyTotal = 0;
+
+  return resumeBody();
+}
+
+
+
+/// <summary>
+/// Continues a body read paused by its callback, call once the consumer is ready for more data
+/// </summary>
+/// <returns>The total number of bytes processed, -1 if the callback aborted or HTTP_BODY_PAUSED if it paused the read again, HTTP_BODY_CANCELLED if the cancellation token fired</returns>
+long int HTTPClient::resumeBody() {
+  size_t r;
+
+  if (!bodyCallback) {
+    return -1;
+  }
+
+  bodyReadPaused = false;
+
+  // continue reading while we're expecting more data
+  do {
+    if (isCancelled()) {
+      return cancelBody();
+    }
+
+    r = readBytes((char*)bodyBuffer, bodyBufferSize);
+    bodyTotal += r;
+
+    Serial.printf(F("[HTTPClient] successfully read %ld bytes\n"), r);
+
+    switch (bodyCallback(bodyBuffer, r)) {
+      case HTTPCallbackResult::Abort:
+        Serial.println(F("[HTTPClient] Write callback failed"));
+        bodyCallback = nullptr;
+        return -1;
+
+      case HTTPCallbackResult::Pause:
+        // Nothing left to pause for once the last of the body has been handed over
+        if (r == bodyBufferSize) {
+          Serial.println(F("[HTTPClient] Body read paused"));
+          bodyReadPaused = true;
+          return HTTP_BODY_PAUSED;
+        }
+        break;
+
+      default:
+        break;
+    }
+  } while (r == bodyBufferSize);
+
+  // A cancel during a wait shows up as a short read
+  if (isCancelled() && !currentParsingConnection->bodyComplete) {
+    return cancelBody();
+  }
+
+  bodyCallback = nullptr;
+
+  return bodyTotal;
+}
+
+
+
+/// <summary>
+/// Abandons the body being read after its cancellation token fired.
+/// When what is left of the body is known and no more than the drain limit it is read and discarded so the connection can be reused,
+/// otherwise the connection is closed.
+/// </summary>
+/// <returns>HTTP_BODY_CANCELLED</returns>
+long int HTTPClient::cancelBody() {
+  bodyCallback = nullptr;
+  bodyReadPaused = false;
+
+  // The token stays set, ignore it while draining
+  HTTPCancellationToken* token = cancelToken;
+
+  cancelToken = nullptr;
+  bool drained = discardBody(cancelDrainLimit);
+  cancelToken = token;
+
+  if (!drained) {
+    Serial.println(F("[HTTPClient] Body cancelled, closing the connection"));
+    close();
+  }
+
+  return HTTP_BODY_CANCELLED;
+}
+
+
+
+/// <summary>
+/// Reads and throws away the rest of the current body, if its remaining length is known and no more than limit bytes
+/// </summary>
+/// <returns>true if the body was read to its end and the connection can take another request</returns>
+bool HTTPClient::discardBody(size_t limit) {
+  size_t remaining = currentParsingConnection->chunkSize;
+  bool chunked = currentParsingConnection->encoding == HTTPTransferEncoding::Chunked;
+  bool known = !chunked && remaining != SIZE_MAX;
+
+  // A chunked body's length is only learnt while reading it, it is drained until it ends or more than limit bytes were read
+  if (!currentParsingConnection->bodyComplete && (chunked || (known && remaining <= limit))) {
+    if (chunked) {
+      Serial.printf(F("[HTTPClient] Draining upto %lu bytes of the chunked body\n"), (unsigned long)limit);
+    } else {
+      Serial.printf(F("[HTTPClient] Draining the remaining %lu bytes of the body\n"), (unsigned long)remaining);
+    }
+
+    uint8_t scratch[64];
+    size_t drained = 0;
+    size_t n;
+
+    // One byte past the limit, so a body of exactly limit bytes still gets its last chunk read
+    while (!currentParsingConnection->bodyComplete && drained <= limit) {
+      n = limit - drained + 1;
+      if (n > sizeof(scratch)) {
+        n = sizeof(scratch);
+      }
+
+      n = readBytes((char*)scratch, n);
+      if (n == 0) {
+        break;
+      }
+
+      drained += n;
+    }
+  }
+
+  return currentParsingConnection->bodyComplete;
+}
+
+
+
+long int HTTPClient::readBody(uint8_t* buffer, size_t bufferSize, HTTP_WRITE_CALLBACK writeCallback) {
+  return readBody(buffer, bufferSize, std::bind(writeCallback, std::placeholders::_1, std::placeholders::_2));
+}
+
+
+
+/// <summary>
+/// Streams the entire HTTP response body through a buffer borrowed from a buffer pool, see readBody(buffer, bufferSize, writeCallback)
+/// </summary>
+/// <param name="writeCallback">Callback invoked when bytes are read into the buffer</param>
+/// <param name="pool">The pool to borrow the buffer from, waits upto the timeout for one to be released when it is exhausted</param>
+/// <returns>The total number of bytes processed, -1 if the callback failed or no buffer could be borrowed</returns>
+long int HTTPClient::readBody(std::function<bool(uint8_t *buffer, size_t dataSize)> writeCallback, HTTPBufferPool& pool) {
+  uint8_t* buffer = pool.acquire(timeout);
+
+  if (buffer == nullptr) {
+    Serial.println(F("[HTTPClient] Buffer pool exhausted"));
+    return -1;
+  }
+
+  long int total = readBody(buffer, pool.bufferSize(), writeCallback);
+  pool.release(buffer);
+
+  return total;
+}
+
+
+
+long int HTTPClient::readBody(String& body, size_t maxCharacters) {
+  char buf[65];
+  size_t n = body.length();
+  size_t r, want;
+
+  while (body.length() - n < maxCharacters) {
+    want = maxCharacters - (body.length() - n);
+    r = readBytes(buf, (want < sizeof(buf) - 1) ? want : sizeof(buf) - 1);
+
+    if (r == 0) {
+      break;
+    }
+
+    buf[r] = '\0';
+    body += buf;
+  }
+
+  return body.length() - n;
+}
+
+
+
+// Read a single byte from the http stream
+int HTTPClient::read() {
+  int a;
+
+  if (currentParsingConnection->chunkSize == 0 && !nextChunk()) {
+    Serial.println(F("[HTTPClient] Read: EOF"));
+    return -1;
+  }
+
+  if ( (a = readRaw()) >= 0) {
+    --currentParsingConnection->chunkSize;
+  }
+
+  return a;
+}
+
+
+
+/// <summary>
+/// Reads bytes from the http body stream for the currently open client
+/// </summary>
+/// <param name="buffer">A pointer to a buffer that is at least length bytes long</param>
+/// <param name="length">The number of bytes to read from the HTTP stream</param>
+/// <returns>The number of bytes read into buffer</returns>
+size_t HTTPClient::readBytes(char* buffer, size_t length) {
+  size_t len = length;  // How much we have left we want to read into the buffer
+  size_t readSize, r;
+
+  while (len > 0) {
+    // We're at a chunk boundary, parse the stupid thing
+    if (currentParsingConnection->chunkSize == 0 && !nextChunk()) {
+      break;
+    }
+
+    // Read the rest of len, or read upto the chunk boundary
+    readSize = (len < currentParsingConnection->chunkSize) ? len : currentParsingConnection->chunkSize;
+
+    r = readRawBytes((uint8_t*)buffer + (length - len), readSize);
+
+    if (r == 0) {
+      if (currentParsingConnection->chunkSize == SIZE_MAX && !client->connected()) {
+        currentParsingConnection->bodyComplete = true;
+        currentParsingConnection->chunkSize = 0;
+      }
+      break;  // timed out or the connection was closed
+    }
+
+    len -= r;
+    currentParsingConnection->chunkSize -= r;
+
+    if (currentParsingConnection->chunkSize == 0 && currentParsingConnection->encoding != EHTTPTransferEncoding::Chunked) {
+      currentParsingConnection->bodyComplete = true;
+    }
+  }
+
+  // do a quick calc instead of using another var
+  return length - len;
+}
+
+
+
+/**
+ * @brief Reads the body's bytes that are buffered or already available from the client, never waiting on the network.
+ * A chunk size line is only parsed once it has arrived whole, nextChunk would wait for the rest of it.
+ *
+ * @return The number of bytes read, 0 when none have arrived, -1 once the body ended or the connection closed
+ */
+long int HTTPClient::readAvailable(uint8_t* buffer, size_t length) {
+  std::shared_ptr<ConnectionInformation>& connection = currentParsingConnection;
+  size_t total = 0;
+  size_t n;
+
+  while (total < length) {
+    if (connection->chunkSize == 0) {
+      if (connection->bodyComplete || connection->encoding != EHTTPTransferEncoding::Chunked) {
+        break;
+      }
+
+      if (!chunkSizeBuffered()) {
+        if (client->available() > 0 && fillReceiveBuffer() > 0) {
+          continue;
+        }
+        break;
+      }
+
+      if (!nextChunk()) {
+        break;
+      }
+      continue;
+    }
+
+    if (rxStart == rxEnd && (client->available() <= 0 || fillReceiveBuffer() == 0)) {
+      break;
+    }
+
+    n = rxEnd - rxStart;
+    if (n > length - total) {
+      n = length - total;
+    }
+    if (n > connection->chunkSize) {
+      n = connection->chunkSize;
+    }
+
+    memcpy(buffer + total, rxBuffer + rxStart, n);
+    rxStart += n;
+    total += n;
+    connection->chunkSize -= n;
+
+    if (connection->chunkSize == 0 && connection->encoding != EHTTPTransferEncoding::Chunked) {
+      connection->bodyComplete = true;
+    }
+  }
+
+  // Once the connection closed nothing more can complete what is left in the receive buffer
+  if (total == 0 && (connection->bodyComplete || (client->available() <= 0 && !client->connected()))) {
+    return -1;
+  }
+
+  return total;
+}
+
+
+
+// True when the line ending after the previous chunk's data and the next chunk size line are in the receive buffer
+bool HTTPClient::chunkSizeBuffered() const {
+  const uint8_t* p = rxBuffer + rxStart;
+  const uint8_t* end = rxBuffer + rxEnd;
+
+  while (p < end && (*p == '\r' || *p == '\n')) {
+    ++p;
+  }
+
+  return p < end && httpFindCRLF(p, end) < end;
+}
+
+
+
+// Moves onto the next chunk of a chunked body, returns false once the body has been fully read or its framing broke off
+bool HTTPClient::nextChunk() {
+  if (currentParsingConnection->bodyComplete || currentParsingConnection->encoding != EHTTPTransferEncoding::Chunked) {
+    return false;
+  }
+
+  // A Boundary is formatted like:
+  // DATA1...\r\n
+  // CHUNKSIZE\r\n
+  // DATA2...\r\n
+  if (!readChunkedDataSize(currentParsingConnection->chunkSize)) {
+    brokenChunk();
+    return false;
+  }
+
+  // The next chunk has a size of 0, this is the end of the body data, skip any trailers upto the final empty line
+  if (currentParsingConnection->chunkSize == 0) {
+    String trailer;
+    bool ended;
+
+    while ((ended = readLine(trailer, HEADER_READ_BUFFER_SIZE)) && trailer.length() > 0);
+
+    if (!ended) {
+      brokenChunk();
+      return false;
+    }
+
+    currentParsingConnection->bodyComplete = true;
+    return false;
+  }
+
+  return true;
+}
+
+
+
+// Reads a chunk size line, returns false if it did not arrive whole or has no hex size at its start
+bool HTTPClient::readChunkedDataSize(size_t& size) {
+  // Ensure we're at the start of our line, skipping the \r\n trailing the previous chunk's data
+  while (true) {
+    if (rxStart == rxEnd && fillReceiveBuffer() == 0) {
+      return false;
+    }
+    if (rxBuffer[rxStart] != '\r' && rxBuffer[rxStart] != '\n') {
+      break;
+    }
+    ++rxStart;
+  }
+
+  // Make sure the whole size line is buffered, it is tiny unless the server sends chunk extensions
+  const uint8_t* eol;
+  while ((eol = httpFindCRLF(rxBuffer + rxStart, rxBuffer + rxEnd)) == rxBuffer + rxEnd) {
+    if (fillReceiveBuffer() == 0) {
+      return false;
+    }
+  }
+
+  // read in the chunk size, a hex formatted number, ignoring any extensions after it
+  const uint8_t* p = rxBuffer + rxStart;
+  int digit;
+
+  size = 0;
+
+  for (; p < eol; ++p) {
+    if (*p >= '0' && *p <= '9') { digit = *p - '0'; }
+    else if (*p >= 'a' && *p <= 'f') { digit = *p - 'a' + 10; }
+    else if (*p >= 'A' && *p <= 'F') { digit = *p - 'A' + 10; }
+    else { break; }
+
+    if (size > (SIZE_MAX >> 4)) {
+      return false;
+    }
+
+    size = (size << 4) | digit;
+  }
+
+  if (p == rxBuffer + rxStart) {
+    Serial.println(F("[HTTPClient] Malformed chunk size line"));
+    return false;
+  }
+
+  rxStart = (eol - rxBuffer) + 2;
+
+  return true;
+}
+
+
+
+// The chunked body was cut off or garbled, the rest of the stream can not be framed anymore so the connection is closed.
+// The body stays incomplete, and unless the wait already timed out the body phase is recorded as the reason
+// Gives up on a response whose header block does not end, counted as running out of the header deadline
+std::shared_ptr<ConnectionInformation>& HTTPClient::tooManyHeaders(std::shared_ptr<ConnectionInformation>& connection) {
+  Serial.printf(F("[HTTPClient] More than %u header lines, giving up\n"), (unsigned)HTTP_MAX_HEADER_LINES);
+
+  if (connection->timeoutReason == HTTPTimeoutReason::TimeoutNone) {
+    timedOut(HTTPTimeoutReason::TimeoutHeader);
+  }
+
+  connection->return_status = 0;
+  connection->chunkSize = 0;
+  connection->bodyComplete = true;
+  connection->keepAlive = false;
+  close();
+
+  return connection;
+}
+
+
+
+void HTTPClient::brokenChunk() {
+  if (currentParsingConnection->timeoutReason == HTTPTimeoutReason::TimeoutNone) {
+    timedOut(HTTPTimeoutReason::TimeoutBody);
+  }
+
+  currentParsingConnection->chunkSize = 0;
+  currentParsingConnection->keepAlive = false;
+  close();
+}
+
+
+
+/// <summary>
+/// Reads more data from the underlying client into the receive buffer, waiting upto the timeout for some to arrive
+/// </summary>
+/// <returns>The number of bytes added to the receive buffer, 0 on timeout, when disconnected or when the buffer is full</returns>
+size_t HTTPClient::fillReceiveBuffer() {
+  // Move any unread data to the front to make room
+  if (rxStart == rxEnd) {
+    rxStart = rxEnd = 0;
+  } else if (rxStart > 0) {
+    memmove(rxBuffer, rxBuffer + rxStart, rxEnd - rxStart);
+    rxEnd -= rxStart;
+    rxStart = 0;
+  }
+
+  size_t space = HTTP_RX_BUFFER_SIZE - rxEnd;
+  if (space == 0) {
+    return 0;
+  }
+
+  size_t avail = waitForData();
+  if (avail == 0) {
+    return 0;
+  }
+
+  int r = client->read(rxBuffer + rxEnd, (avail < space) ? avail : space);
+  if (r <= 0) {
+    return 0;
+  }
+
+  rxEnd += r;
+  return r;
+}
+
+
+
+// Waits upto the timeout for the underlying client to have data, giving up early when disconnected or cancelled.
+// The phase deadline holds even while data keeps arriving, so a server trickling an endless response is still cut off
+// returns the number of bytes available, or 0
+size_t HTTPClient::waitForData() {
+  unsigned long start = millis();
+  unsigned long idle = (deadlines.idle != 0) ? deadlines.idle : timeout;
+  unsigned long now;
+  int avail;
+
+  for (;;) {
+    avail = client->available();
+    now = millis();
+
+    if (phaseLimit != 0 && now - phaseStart >= phaseLimit) {
+      timedOut(phaseReason);
+      return 0;
+    }
+
+    if (avail > 0) {
+      return avail;
+    }
+
+    if (!client->connected() || isCancelled()) {
+      return 0;
+    }
+
+    if (now - start >= idle) {
+      timedOut(HTTPTimeoutReason::TimeoutIdle);
+      return 0;
+    }
+
+    yield();
+  }
+}
+
+
+
+// Starts timing a phase of the request, a limit of 0 means the phase has no deadline of its own
+void HTTPClient::beginPhase(HTTPTimeoutReason reason, unsigned long start, unsigned long limit) {
+  phaseReason = reason;
+  phaseStart = start;
+  phaseLimit = limit;
+}
+
+
+
+void HTTPClient::timedOut(HTTPTimeoutReason reason) {
+  if (lastTimeoutReason == HTTPTimeoutReason::TimeoutNone) {
+    Serial.printf(F("[HTTPClient] Timed out, reason %u\n"), (unsigned)reason);
+  }
+
+  lastTimeoutReason = reason;
+  currentParsingConnection->timeoutReason = reason;
+}
+
+
+
+int HTTPClient::readRaw() {
+  if (rxStart == rxEnd && fillReceiveBuffer() == 0) {
+    return -1;
+  }
+
+  return rxBuffer[rxStart++];
+}
+
+
+
+// Reads length bytes, taking buffered data first and reading large remainders straight into the callers buffer
+size_t HTTPClient::readRawBytes(uint8_t* buffer, size_t length) {
+  size_t total = 0;
+  size_t n;
+
+  while (total < length) {
+    if (rxStart == rxEnd) {
+      if (length - total >= HTTP_RX_BUFFER_SIZE) {
+        n = waitForData();
+        if (n == 0) {
+          break;
+        }
+
+        int r = client->read(buffer + total, (n < length - total) ? n : length - total);
+        if (r <= 0) {
+          break;
+        }
+        total += r;
+        continue;
+      }
+
+      if (fillReceiveBuffer() == 0) {
+        break;
+      }
+    }
+
+    n = rxEnd - rxStart;
+    if (n > length - total) {
+      n = length - total;
+    }
+
+    memcpy(buffer + total, rxBuffer + rxStart, n);
+    rxStart += n;
+    total += n;
+  }
+
+  return total;
+}
+
+
+
+/// <summary>
+/// Reads a single CRLF terminated line, the line ending is consumed but not stored
+/// </summary>
+/// <param name="line">Receives the line, anything past maxLength characters is dropped</param>
+/// <param name="maxLength">The maximum number of characters to store</param>
+/// <returns>false if the timeout elapsed or the connection closed before any line ending was found</returns>
+bool HTTPClient::readLine(String& line, size_t maxLength) {
+  line = "";
+
+  while (true) {
+    const uint8_t* begin = rxBuffer + rxStart;
+    const uint8_t* end = rxBuffer + rxEnd;
+    const uint8_t* eol = httpFindCRLF(begin, end);
+
+    // Keep a trailing '\r' buffered, it may be the start of our line ending
+    size_t n = (eol < end || begin == end || end[-1] != '\r') ? eol - begin : eol - begin - 1;
+    size_t keep = (line.length() + n > maxLength) ? maxLength - line.length() : n;
+
+    if (keep > 0) {
+      uint8_t saved = rxBuffer[rxStart + keep];
+      rxBuffer[rxStart + keep] = '\0';
+      line += (const char*)begin;
+      rxBuffer[rxStart + keep] = saved;
+    }
+
+    rxStart += n;
+
+    if (eol < end) {
+      rxStart += 2;
+      return true;
+    }
+
+    if (fillReceiveBuffer() == 0) {
+      return false;
+    }
+  }
+}
+
+
+
+// Adds data to the transmit buffer, flushing it when full. Data larger than the buffer is written straight through
+bool HTTPClient::txAppend(const uint8_t* data, size_t length) {
+  if (txLength + length > sizeof(txBuffer)) {
+    if (!txFlush()) {
+      return false;
+    }
+
+    if (length >= sizeof(txBuffer)) {
+      size_t written = client->write(data, length);
+      requestWritten = requestWritten || written > 0;
+
+      return written == length;
+    }
+  }
+
+  memcpy(txBuffer + txLength, data, length);
+  txLength += length;
+
+  return true;
+}
+
+
+
+// As txAppend, for data that may be in flash
+bool HTTPClient::txAppendFlash(const char* data, size_t length) {
+  size_t n;
+
+  while (length > 0) {
+    if (txLength == sizeof(txBuffer) && !txFlush()) {
+      return false;
+    }
+
+    n = sizeof(txBuffer) - txLength;
+    if (n > length) {
+      n = length;
+    }
+
+    memcpy_P(txBuffer + txLength, data, n);
+    txLength += n;
+    data += n;
+    length -= n;
+  }
+
+  return true;
+}
+
+
+
+// Writes out whatever the transmit buffer holds, false if the connection did not take all of it
+bool HTTPClient::txFlush() {
+  size_t length = txLength;
+
+  txLength = 0;
+
+  if (length == 0) {
+    return true;
+  }
+
+  size_t written = client->write(txBuffer, length);
+  requestWritten = requestWritten || written > 0;
+
+  return written == length;
+}
+
+
+
+bool HTTPClient::readBody(DynamicJsonDocument& outDoc) {
+  // Reads are served from the receive buffer, no extra buffering stream needs allocating
   DeserializationError err;
-  ReadBufferingClient rbc(*this, 128);
 
-  err = deserializeJson(outDoc, rbc);
+  err = deserializeJson(outDoc, *this);
 
   if (err) {
     Serial.print(F("[HTTPClient] There was an error parsing the JSON response: "));
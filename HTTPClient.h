@@ -6,12 +6,20 @@
 #include <Arduino.h>
 #include <Client.h>
 #include <ArduinoJson.h>
-#include <StreamUtils.h>
+#include "HTTPScan.h"
+#include "HTTPUrl.h"
+#include "HTTPBufferPool.h"
+#include "HTTPRttEstimator.h"
+#include "HTTPCircuitBreaker.h"
+#include "HTTPRequestTemplate.h"
+#include "HTTPHeaderSet.h"
+#include "HTTPBodySource.h"
 
 #include <stdint.h>
 #include <vector>
 #include <functional>
 #include <memory>
+#include <atomic>
 
 
 
@@ -35,6 +43,36 @@
 
 #define HEADER_READ_BUFFER_SIZE 2048
 
+// Longest request line (method, path, query and version) the URL based requests can compose
+#ifndef HTTP_REQUEST_LINE_SIZE
+#define HTTP_REQUEST_LINE_SIZE 512
+#endif
+
+// Longest host name the URL based requests can connect to
+#ifndef HTTP_MAX_HOST_LENGTH
+#define HTTP_MAX_HOST_LENGTH 128
+#endif
+
+// Size of the transmit buffer a request head (and small body) is coalesced into before it is written
+#ifndef HTTP_TX_BUFFER_SIZE
+#define HTTP_TX_BUFFER_SIZE 512
+#endif
+
+// Upper bound for the segments (request line, header blocks, body) a request is gathered from before it is written
+#ifndef HTTP_IOVEC_MAX
+#define HTTP_IOVEC_MAX 32
+#endif
+
+// Most header lines (of one response, interim ones counted separately) read before the response is given up on
+#ifndef HTTP_MAX_HEADER_LINES
+#define HTTP_MAX_HEADER_LINES 64
+#endif
+
+// Size of the receive buffer the header and chunk framing parsers scan in place
+#ifndef HTTP_RX_BUFFER_SIZE
+#define HTTP_RX_BUFFER_SIZE 512
+#endif
+
 
 
 typedef enum EHTTPTransferEncoding : uint8_t {
@@ -47,10 +85,96 @@ typedef enum EHTTPTransferEncoding : uint8_t {
 
 
 
+typedef enum EHTTPTimeoutReason : uint8_t {
+  TimeoutNone,
+  TimeoutConnect,     // connecting took longer than the connect deadline
+  TimeoutFirstByte,   // no response arrived within the first byte deadline of sending the request
+  TimeoutHeader,      // the status line and headers were not complete within the header deadline of sending the request
+  TimeoutBody,        // the body was not complete within the body deadline of the end of the headers
+  TimeoutIdle,        // nothing arrived for longer than the idle gap (or the client timeout when no idle gap is set)
+} HTTPTimeoutReason;
+
+
+
+// Deadlines in milliseconds for each phase of a request, 0 disables a deadline
+struct HTTPDeadlines {
+  unsigned long connect = 0;
+  unsigned long firstByte = 0;
+  unsigned long header = 0;
+  unsigned long body = 0;
+  unsigned long idle = 0;
+};
+
+
+
+struct HTTPRetryPolicy {
+  uint8_t maxAttempts = 1;          // attempts in total, 1 never retries
+  unsigned long baseDelay = 250;    // backoff before the second attempt in ms, doubled for every attempt after
+  unsigned long maxDelay = 10000;   // backoff cap, a longer Retry-After gives up instead
+  bool retryNonIdempotent = false;  // also retry POST and PATCH requests
+  bool respectRetryAfter = true;
+};
+
+
+
+// One segment of a gathered write
+struct HTTPIoVec {
+  const void* data = nullptr;
+  size_t length = 0;
+  bool flash = false;   // data may be in flash, read it with memcpy_P
+};
+
+
+
+// Implemented by transports that can submit several buffers in one call, e.g. with writev on a POSIX socket.
+// It must write to the connection of the Client wrapped by the HTTPClient
+class HTTPGatherWriter
+{
+public:
+  virtual ~HTTPGatherWriter() {}
+
+  // Writes all segments in order, returns the number of bytes written
+  virtual size_t writeGathered(const HTTPIoVec* vec, size_t count) = 0;
+};
+
+
+
+// Everything needed to send a request, kept so retries and redirects can send it again
+struct HTTPRequest {
+  const char* line = nullptr;                             // request line, without the CRLF
+  const char* headers = nullptr;                          // header lines, may be nullptr
+  const HTTPHeaderSet* headerSet = nullptr;               // written before headers
+  const HTTPRequestTemplate* requestTemplate = nullptr;   // replaces line and headers when set
+  const char* const* values = nullptr;                    // the template's slot values
+  size_t valueCount = 0;
+  const uint8_t* body = nullptr;
+  size_t bodyLength = 0;
+  HTTPBodySource* source = nullptr;                       // streamed instead of body when set
+  bool secure = false;                                    // https, set by URL requests, requests to port 443 count as https too
+};
+
+
+
+typedef enum EHTTPUploadStatus : uint8_t {
+  UploadIdle,       // no upload started, or its response has been read
+  UploadSending,    // the request is still being written, keep polling
+  UploadComplete,   // everything was written, read the response with finishUpload
+  UploadFailed,     // the connection or the body source failed, or the upload was cancelled or stalled
+} HTTPUploadStatus;
+
+typedef std::function<void(size_t sent, long int total)> HTTPUploadProgressCallback;
+
+
+
 struct ConnectionInformation {
   size_t chunkSize = 0;
   uint16_t return_status = 0;
   HTTPTransferEncoding encoding = HTTPTransferEncoding::None; 
+  bool bodyComplete = false;
+  HTTPTimeoutReason timeoutReason = HTTPTimeoutReason::TimeoutNone;
+  bool keepAlive = true;
+  unsigned long retryAfter = 0;   // in ms, 0 when the server did not send Retry-After
+  String location;                // the Location header of redirects
 };
 
 
@@ -59,28 +183,125 @@ typedef bool(*HTTP_WRITE_CALLBACK)(uint8_t* buffer, size_t bufferSize);
 
 
 
+// What a streaming body callback wants the client to do next
+typedef enum EHTTPCallbackResult : uint8_t {
+  Continue,   // keep reading
+  Pause,      // stop pulling from the socket until resumeBody() is called
+  Abort,      // give up on the body, the read returns -1
+} HTTPCallbackResult;
+
+typedef std::function<HTTPCallbackResult(uint8_t *buffer, size_t dataSize)> HTTPBodyCallback;
+
+// Returned by streamBody and resumeBody while the callback has paused the read
+#define HTTP_BODY_PAUSED -2
+// Returned by streamBody and resumeBody when the cancellation token fired
+#define HTTP_BODY_CANCELLED -3
+
+// Bodies with no more than this many bytes left are drained on cancel to keep the connection, larger ones are closed
+#ifndef HTTP_CANCEL_DRAIN_LIMIT
+#define HTTP_CANCEL_DRAIN_LIMIT 1024
+#endif
+
+
+
+// Lets another task abort a request in flight, checked at buffer boundaries and while waiting on the network
+class HTTPCancellationToken
+{
+public:
+  void cancel() { cancelled.store(true, std::memory_order_release); }
+  void reset() { cancelled.store(false, std::memory_order_release); }
+  bool isCancelled() const { return cancelled.load(std::memory_order_acquire); }
+
+private:
+  std::atomic<bool> cancelled{false};
+};
+
+
+
+// All parsing state lives in the instance or in the ConnectionInformation of the response being read,
+// separate instances wrapping separate Clients can be used from different tasks or cores at the same time.
+// A single instance is not synchronised, only one task may use it at a time.
 class HTTPClient : public Client
 {
 public:
   HTTPClient(Client &client, unsigned long timeout = 5000);
   virtual ~HTTPClient();
 
-  std::shared_ptr<ConnectionInformation> http_put(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders)
-    { return sendHTMLRequest(hostname, port, MAKE_PUT(request), inHeaders, outHeaders); }
+  std::shared_ptr<ConnectionInformation> http_put(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders,
+      const uint8_t* body = nullptr, size_t bodyLength = 0)
+    { return sendHTMLRequest(hostname, port, MAKE_PUT(request), inHeaders, outHeaders, body, bodyLength); }
   std::shared_ptr<ConnectionInformation> http_get(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders)
     { return sendHTMLRequest(hostname, port, MAKE_GET(request), inHeaders, outHeaders); }
-  std::shared_ptr<ConnectionInformation> http_post(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders)
-    { return sendHTMLRequest(hostname, port, MAKE_POST(request), inHeaders, outHeaders); }
+  std::shared_ptr<ConnectionInformation> http_post(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders,
+      const uint8_t* body = nullptr, size_t bodyLength = 0)
+    { return sendHTMLRequest(hostname, port, MAKE_POST(request), inHeaders, outHeaders, body, bodyLength); }
   std::shared_ptr<ConnectionInformation> http_head(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders)
     { return sendHTMLRequest(hostname, port, MAKE_HEAD(request), inHeaders, outHeaders); }
   std::shared_ptr<ConnectionInformation> http_delete(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders)
     { return sendHTMLRequest(hostname, port, MAKE_DELETE(request), inHeaders, outHeaders); }
-  std::shared_ptr<ConnectionInformation> http_patch(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders)
-    { return sendHTMLRequest(hostname, port, MAKE_PATCH(request), inHeaders, outHeaders); }
+  std::shared_ptr<ConnectionInformation> http_patch(const char* hostname, uint16_t port, const String& request, const char* inHeaders, std::vector<String> *outHeaders,
+      const uint8_t* body = nullptr, size_t bodyLength = 0)
+    { return sendHTMLRequest(hostname, port, MAKE_PATCH(request), inHeaders, outHeaders, body, bodyLength); }
+
+  // URL based requests, e.g. http_get("http://host:8080/path?a=b", nullptr, nullptr, &query)
+  // The URL is parsed in place and the request line composed in a fixed size buffer, query parameters are percent-encoded straight into it
+  std::shared_ptr<ConnectionInformation> http_put(const char* url, const char* inHeaders, std::vector<String> *outHeaders, const HTTPQuery* query = nullptr,
+      const uint8_t* body = nullptr, size_t bodyLength = 0)
+    { return sendUrlRequest("PUT", url, query, inHeaders, outHeaders, body, bodyLength); }
+  std::shared_ptr<ConnectionInformation> http_get(const char* url, const char* inHeaders, std::vector<String> *outHeaders, const HTTPQuery* query = nullptr)
+    { return sendUrlRequest("GET", url, query, inHeaders, outHeaders); }
+  std::shared_ptr<ConnectionInformation> http_post(const char* url, const char* inHeaders, std::vector<String> *outHeaders, const HTTPQuery* query = nullptr,
+      const uint8_t* body = nullptr, size_t bodyLength = 0)
+    { return sendUrlRequest("POST", url, query, inHeaders, outHeaders, body, bodyLength); }
+  std::shared_ptr<ConnectionInformation> http_head(const char* url, const char* inHeaders, std::vector<String> *outHeaders, const HTTPQuery* query = nullptr)
+    { return sendUrlRequest("HEAD", url, query, inHeaders, outHeaders); }
+  std::shared_ptr<ConnectionInformation> http_delete(const char* url, const char* inHeaders, std::vector<String> *outHeaders, const HTTPQuery* query = nullptr)
+    { return sendUrlRequest("DELETE", url, query, inHeaders, outHeaders); }
+  std::shared_ptr<ConnectionInformation> http_patch(const char* url, const char* inHeaders, std::vector<String> *outHeaders, const HTTPQuery* query = nullptr,
+      const uint8_t* body = nullptr, size_t bodyLength = 0)
+    { return sendUrlRequest("PATCH", url, query, inHeaders, outHeaders, body, bodyLength); }
+
+  // Sends a request built from a template, values fill its {0} to {9} slots and the body's length its {len} slot.
+  // Redirects are returned to the caller, a template's path can not be rewritten
+  std::shared_ptr<ConnectionInformation> http_send(const char* hostname, uint16_t port, const HTTPRequestTemplate& requestTemplate,
+    const char* const* values, size_t valueCount, const uint8_t* body, size_t bodyLength, std::vector<String> *outHeaders);
+
+  // Uploads a body pulled from source block by block, chunked when its length is not known.
+  // Blocks until it has been sent, see beginUpload for a version that does not
+  std::shared_ptr<ConnectionInformation> http_upload(const char* hostname, uint16_t port, const char* request, const char* inHeaders,
+    HTTPBodySource& source, std::vector<String> *outHeaders);
+
+  // Non-blocking upload: beginUpload connects and queues the head, every pollUpload writes only what the transport can take
+  // without blocking (availableForWrite), and once it returns UploadComplete finishUpload reads the response.
+  // request is a full request line, e.g. MAKE_POST("/logs"). The source must outlive the upload
+  bool beginUpload(const char* hostname, uint16_t port, const char* request, const char* inHeaders, HTTPBodySource& source);
+  HTTPUploadStatus pollUpload() { return pumpUpload(); }
+  std::shared_ptr<ConnectionInformation> finishUpload(std::vector<String> *outHeaders);
+  HTTPUploadStatus uploadStatus() const { return uploadState; }
+  // Body bytes written so far
+  size_t uploadSent() const { return uploadBytes; }
+  void setUploadProgress(HTTPUploadProgressCallback callback) { uploadProgress = callback; }
 
   long int readBody(uint8_t* buffer, size_t bufferSize, std::function<bool(uint8_t *buffer, size_t dataSize)> writeCallback);
   long int readBody(uint8_t* buffer, size_t bufferSize, HTTP_WRITE_CALLBACK writeCallback);
   long int readBody(String& body, size_t maxCharacters);
+  long int readBody(std::function<bool(uint8_t *buffer, size_t dataSize)> writeCallback, HTTPBufferPool& pool = HTTPBufferPool::shared());
+
+  long int streamBody(uint8_t* buffer, size_t bufferSize, HTTPBodyCallback writeCallback);
+  long int resumeBody();
+  bool bodyPaused() const { return bodyReadPaused; }
+
+  // Reads what has arrived of the body without waiting for more, for bodies that never end such as event streams.
+  // Returns the number of bytes read, 0 when nothing has arrived, -1 once the body ended or the connection closed
+  long int readAvailable(uint8_t* buffer, size_t length);
+  // Waits for more data the way the blocking reads do: upto the timeout (or the idle deadline) and within the phase's deadline,
+  // giving up early when the connection closes or the cancellation token fires. Returns the number of bytes available, 0 if none came
+  size_t waitForData();
+  bool isCancelled() const { return cancelToken != nullptr && cancelToken->isCancelled(); }
+  // Transmit buffer, small writes are gathered and go out in one write to the underlying client.
+  // Also for protocols taking over the connection after an upgrade, so their frames are not split into many small writes
+  bool txAppend(const uint8_t* data, size_t length);
+  bool txFlush();
 
   bool readBody(DynamicJsonDocument& outDoc);
 
@@ -93,15 +314,55 @@ public:
   template<size_t A, size_t B>
   bool readBody(StaticJsonDocument<A>& outDoc, const StaticJsonDocument<B>* filter = nullptr);
 
-  void setTimeout(unsigned long timeout) {if(client != nullptr) client->setTimeout(timeout);}
+  // Send the set's headers (and those of the sets it extends) with every request, nullptr detaches it.
+  // The set is not owned by the client, inHeaders are still sent after it
+  void setHeaders(const HTTPHeaderSet* headers) { headerSet = headers; }
+
+  // Hand requests to a transport that writes several buffers in one call instead of coalescing them in the transmit buffer, nullptr detaches it.
+  // The writer is not owned by the client
+  void setGatherWriter(HTTPGatherWriter* writer) { gatherWriter = writer; }
+
+  // Send requests with a body with Expect: 100-continue and hold the body back upto timeout ms for the server's go ahead,
+  // a server refusing the request (auth, quota) answers before the body went out. 0 (the default) sends bodies straight away.
+  // Applies to blocking requests, not to templates or beginUpload
+  void setExpectContinue(unsigned long timeout) { expectContinueTimeout = timeout; }
+
+  // The token is not owned by the client, pass nullptr to detach it
+  void setCancellationToken(HTTPCancellationToken* token) { cancelToken = token; }
+  void setCancelDrainLimit(size_t bytes) { cancelDrainLimit = bytes; }
+
+  // Deadlines are enforced by the client itself, on top of the timeout which bounds every individual wait
+  void setDeadlines(const HTTPDeadlines& deadlines) { this->deadlines = deadlines; }
+  const HTTPDeadlines& getDeadlines() const { return deadlines; }
+  // Failed attempts (no connection, no response, 429, 500, 502, 503, 504) are retried with a jittered exponential backoff
+  void setRetryPolicy(const HTTPRetryPolicy& policy) { retryPolicy = policy; }
+  // True if the request line starts with a GET, HEAD, PUT, DELETE, OPTIONS or TRACE method, the ones retried by default
+  static bool isIdempotent(const char* request);
+
+  // Follow upto maxHops 301, 302, 303, 307 and 308 redirects, 0 (the default) returns redirects to the caller
+  void setFollowRedirects(uint8_t maxHops) { maxRedirects = maxHops; }
+
+  // Fail requests to hosts that keep failing (no connection, no response or a 5xx status) without contacting them, nullptr turns it off.
+  // The breaker is not owned by the client
+  void setCircuitBreaker(HTTPCircuitBreaker* breaker) { circuitBreaker = breaker; }
+  // True when the last request was failed fast by an open breaker
+  bool lastRequestRejected() const { return circuitRejected; }
+
+  // Derive the connect and first byte deadlines left at 0 from the host's measured round trip times, nullptr turns it off.
+  // The estimator is not owned by the client
+  void setRttEstimator(HTTPRttEstimator* estimator) { rttEstimator = estimator; }
+  // Why the last request timed out, also set on the response when there was one
+  HTTPTimeoutReason lastTimeout() const { return lastTimeoutReason; }
+
+  void setTimeout(unsigned long timeout) {this->timeout = timeout; if(client != nullptr) client->setTimeout(timeout);}
 
   // helper functions for parsing JSON with chunked encoding
   virtual int read() override;
   virtual int read(uint8_t *buf, size_t size) override {return readBytes((char*)buf, size);}
   virtual int available() override
-    {return client->available();}
+    {return (rxEnd - rxStart) + client->available();}
   virtual int peek() override
-    {return client->peek();}
+    {return (rxStart < rxEnd) ? rxBuffer[rxStart] : client->peek();}
   virtual size_t write(uint8_t b) override
     {return client->write(b);}
   virtual int availableForWrite(void)	override
@@ -125,15 +386,103 @@ public:
   size_t readBytes(char* buffer, size_t length);
 
 protected:
-  std::shared_ptr<ConnectionInformation> sendHTMLRequest(const char* hostname, uint16_t port, const char* request, const char* inHeaders, std::vector<String> *outHeaders);
+  std::shared_ptr<ConnectionInformation> sendHTMLRequest(const char* hostname, uint16_t port, const char* request, const char* inHeaders, std::vector<String> *outHeaders,
+    const uint8_t* body = nullptr, size_t bodyLength = 0);
+  std::shared_ptr<ConnectionInformation> sendUrlRequest(const char* method, const char* url, const HTTPQuery* query, const char* inHeaders, std::vector<String> *outHeaders,
+    const uint8_t* body = nullptr, size_t bodyLength = 0);
+  std::shared_ptr<ConnectionInformation> sendRequest(const char* hostname, uint16_t port, HTTPRequest request, std::vector<String> *outHeaders);
+  std::shared_ptr<ConnectionInformation> sendWithRetries(const char* hostname, uint16_t port, const HTTPRequest& request, std::vector<String> *outHeaders);
+  bool resolveRedirect(const String& location, bool& secure, String& host, uint16_t& port, String& path);
+  static void removeDotSegments(String& path);
+  std::shared_ptr<ConnectionInformation> sendRequestAttempt(const char* hostname, uint16_t port, const HTTPRequest& request, std::vector<String> *outHeaders);
+  bool openConnection(const char* hostname, uint16_t port, bool allowReuse, bool& reused);
+  bool writeRequest(const char* hostname, uint16_t port, const HTTPRequest& request, bool flush = true);
+  bool writeGathered(const HTTPIoVec* vec, size_t count, bool flush = true);
+  bool awaitContinue();
+  void startUpload(HTTPBodySource* source);
+  HTTPUploadStatus pumpUpload();
+  HTTPUploadStatus failUpload();
+  bool mayRepeat(const HTTPRequest& request);
+  bool shouldRetry(const std::shared_ptr<ConnectionInformation>& result);
+  unsigned long retryDelay(uint8_t attempt, const std::shared_ptr<ConnectionInformation>& result);
   std::shared_ptr<ConnectionInformation> readResponseStatus(std::vector<String>* headers);
   std::shared_ptr<ConnectionInformation>& readHeaders(std::shared_ptr<ConnectionInformation>& connection, std::vector<String>* headers);
-  size_t readChunkedDataSize();
+  bool readChunkedDataSize(size_t& size);
+  std::shared_ptr<ConnectionInformation>& tooManyHeaders(std::shared_ptr<ConnectionInformation>& connection);
+  void brokenChunk();
+  bool chunkSizeBuffered() const;
+  bool nextChunk();
+  long int cancelBody();
+  bool discardBody(size_t limit);
   void close();
 
+  // Receive buffer access, everything read from the underlying client goes through these
+  size_t fillReceiveBuffer();
+  void beginPhase(HTTPTimeoutReason reason, unsigned long start, unsigned long limit);
+  void timedOut(HTTPTimeoutReason reason);
+  int readRaw();
+  size_t readRawBytes(uint8_t* buffer, size_t length);
+  bool readLine(String& line, size_t maxLength);
+
+  bool txAppendFlash(const char* data, size_t length);
+
 protected:
   Client *client;
   std::shared_ptr<ConnectionInformation> currentParsingConnection;
+  unsigned long timeout;
+
+  // State of a body read driven by streamBody, kept while paused
+  uint8_t* bodyBuffer = nullptr;
+  size_t bodyBufferSize = 0;
+  HTTPBodyCallback bodyCallback;
+  long int bodyTotal = 0;
+  bool bodyReadPaused = false;
+
+  const HTTPHeaderSet* headerSet = nullptr;
+  HTTPGatherWriter* gatherWriter = nullptr;
+  unsigned long expectContinueTimeout = 0;
+  bool bodyWithheld = false;      // the server answered Expect: 100-continue with a final status, the body was never sent
+  bool requestWritten = false;    // some of the request reached the connection
+  bool headRequest = false;       // the request being answered is a HEAD, its response has no body
+
+  uint8_t maxRedirects = 0;
+  HTTPRetryPolicy retryPolicy;
+  HTTPCircuitBreaker* circuitBreaker = nullptr;
+  bool circuitRejected = false;
+  uint32_t connectedKey = 0;   // host the open connection is to, 0 when there is none
+
+  HTTPDeadlines deadlines;
+  HTTPTimeoutReason lastTimeoutReason = HTTPTimeoutReason::TimeoutNone;
+  HTTPTimeoutReason phaseReason = HTTPTimeoutReason::TimeoutNone;
+  HTTPRttEstimator* rttEstimator = nullptr;
+  uint32_t rttKey = 0;
+  unsigned long requestSentAt = 0;
+  unsigned long phaseStart = 0;
+  unsigned long phaseLimit = 0;
+
+  HTTPCancellationToken* cancelToken = nullptr;
+  size_t cancelDrainLimit = HTTP_CANCEL_DRAIN_LIMIT;
+
+  // One spare byte past the end is kept for null terminating in place
+  uint8_t rxBuffer[HTTP_RX_BUFFER_SIZE + 1];
+  size_t rxStart = 0;
+  size_t rxEnd = 0;
+
+  uint8_t txBuffer[HTTP_TX_BUFFER_SIZE];
+  size_t txLength = 0;
+  size_t txSent = 0;      // bytes of the transmit buffer an upload has written
+
+  // State of an upload driven by pumpUpload
+  HTTPBodySource* uploadSource = nullptr;
+  HTTPUploadStatus uploadState = HTTPUploadStatus::UploadIdle;
+  HTTPUploadProgressCallback uploadProgress;
+  long int uploadLength = -1;
+  size_t uploadBytes = 0;
+  size_t uploadBlock = 0;         // body bytes in the transmit buffer
+  bool uploadChunked = false;
+  bool uploadEnded = false;       // the source is exhausted, what is left in the transmit buffer is the end of the body
+  bool uploadBlocking = false;    // the transport does not report availableForWrite, every write may block
+  unsigned long uploadLastProgress = 0;
 };
 
 
@@ -141,21 +490,16 @@ protected:
 template<size_t A>
 bool HTTPClient::readBody(DynamicJsonDocument& outDoc, const StaticJsonDocument<A>* filter)
 {
-  if (currentParsingConnection->encoding == HTTPTransferEncoding::Chunked)
-  {
-    currentParsingConnection->chunkSize = readChunkedDataSize();
-  }
-
+  // Reads are served from the receive buffer, no extra buffering stream needs allocating
   DeserializationError err;
-  ReadBufferingClient rbc(*this, 128);
 
   if (filter != nullptr)
   {
-    err = deserializeJson(outDoc, rbc, DeserializationOption::Filter(*filter));
+    err = deserializeJson(outDoc, *this, DeserializationOption::Filter(*filter));
   }
   else
   {
-    err = deserializeJson(outDoc, rbc);
+    err = deserializeJson(outDoc, *this);
   }
 
   if (err)
@@ -172,15 +516,10 @@ bool HTTPClient::readBody(DynamicJsonDocument& outDoc, const StaticJsonDocument<
 template<size_t A>
 bool HTTPClient::readBody(StaticJsonDocument<A>& outDoc)
 {
-  if (currentParsingConnection->encoding == HTTPTransferEncoding::Chunked)
-  {
-    currentParsingConnection->chunkSize = readChunkedDataSize();
-  }
-
+  // Reads are served from the receive buffer, no extra buffering stream needs allocating
   DeserializationError err;
-  ReadBufferingClient rbc(*this, 128);
 
-  err = deserializeJson(outDoc, rbc);
+  err = deserializeJson(outDoc, *this);
 
   if (err)
   {
@@ -196,21 +535,16 @@ bool HTTPClient::readBody(StaticJsonDocument<A>& outDoc)
 template<size_t A, size_t B>
 bool HTTPClient::readBody(StaticJsonDocument<A>& outDoc, const StaticJsonDocument<B>* filter)
 {
-  if (currentParsingConnection->encoding == HTTPTransferEncoding::Chunked)
-  {
-    currentParsingConnection->chunkSize = readChunkedDataSize();
-  }
-
+  // Reads are served from the receive buffer, no extra buffering stream needs allocating
   DeserializationError err;
-  ReadBufferingClient rbc(*this, 128);
 
   if (filter != nullptr)
   {
-    err = deserializeJson(outDoc, rbc, DeserializationOption::Filter(*filter));
+    err = deserializeJson(outDoc, *this, DeserializationOption::Filter(*filter));
   }
   else
   {
-    err = deserializeJson(outDoc, rbc);
+    err = deserializeJson(outDoc, *this);
   }
 
   if (err)
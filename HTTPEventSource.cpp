@@ -0,0 +1,337 @@
+#include "HTTPEventSource.h"
+
+
+
+HTTPEventSource::HTTPEventSource(HTTPClient& client, const char* hostname, uint16_t port, const char* path) :
+  client(client),
+  hostname(hostname),
+  port(port),
+  path(path)
+{
+  lastId[0] = '\0';
+}
+
+
+
+/**
+ * @brief Opens the stream when a (re)connect is due, then parses and dispatches whatever has arrived on it without waiting for more.
+ *
+ * @return true while the stream is open
+ */
+bool HTTPEventSource::poll() {
+  uint8_t buffer[64];
+  long int r = 0;
+
+  if (stopped) {
+    return false;
+  }
+
+  if (!open && (millis() - disconnectedAt < reconnectDelay || !connect())) {
+    return false;
+  }
+
+  while (open && (r = client.readAvailable(buffer, sizeof(buffer))) > 0) {
+    receivedAt = millis();
+    failures = 0;
+
+    // A callback may stop the stream
+    for (long int i = 0; i < r && open; ++i) {
+      parse(buffer[i]);
+    }
+  }
+
+  if (!open) {
+    return false;
+  }
+
+  if (r < 0 || (idleTimeout != 0 && millis() - receivedAt >= idleTimeout)) {
+    Serial.println(F("[HTTPEventSource] Stream ended, reconnecting"));
+
+    disconnect();
+    return false;
+  }
+
+  return true;
+}
+
+
+
+void HTTPEventSource::stop() {
+  if (open) {
+    client.stop();
+    open = false;
+  }
+
+  stopped = true;
+  reconnectDelay = 0;
+}
+
+
+
+// True if the Content-Type is text/event-stream, parameters such as a charset are allowed
+static bool isEventStream(const std::vector<String>& headers) {
+  static const char type[] = "text/event-stream";
+  static const size_t typeLength = sizeof(type) - 1;
+
+  for (const String& header : headers) {
+    int colon = header.indexOf(':');
+
+    if (colon != 12 || !header.substring(0, colon).equalsIgnoreCase("content-type")) {
+      continue;
+    }
+
+    String value = header.substring(colon + 1);
+    value.trim();
+
+    return value.length() >= typeLength && value.substring(0, typeLength).equalsIgnoreCase(type)
+      && (value.length() == typeLength || value[typeLength] == ';' || value[typeLength] == ' ');
+  }
+
+  return false;
+}
+
+
+
+// Requests the stream, resuming after the last event id seen. A 204 tells the client to stop reconnecting
+bool HTTPEventSource::connect() {
+  String headers = "Accept: text/event-stream\r\nCache-Control: no-cache\r\n";
+
+  if (lastId[0] != '\0') {
+    headers += "Last-Event-ID: ";
+    headers += lastId;
+    headers += "\r\n";
+  }
+
+  std::vector<String> responseHeaders;
+  std::shared_ptr<ConnectionInformation> result = client.http_get(hostname, port, path, headers.c_str(), &responseHeaders);
+  uint16_t status = (result != nullptr) ? result->return_status : 0;
+
+  if (status == 204) {
+    Serial.println(F("[HTTPEventSource] Server ended the subscription"));
+
+    client.stop();
+    stopped = true;
+    return false;
+  }
+
+  if (status != 200) {
+    Serial.printf(F("[HTTPEventSource] Could not open the stream, status %hu\n"), status);
+
+    disconnect();
+    return false;
+  }
+
+  // Anything but an event stream fails the subscription for good, reconnecting would get the same answer
+  if (!isEventStream(responseHeaders)) {
+    Serial.println(F("[HTTPEventSource] Response is not text/event-stream, giving up"));
+
+    client.stop();
+    stopped = true;
+    return false;
+  }
+
+  open = true;
+  receivedAt = millis();
+
+  // Whatever was cut off by the last disconnect is not an event, the id it resumes from is kept
+  field = EventField::FieldNone;
+  nameLength = 0;
+  skipSpace = false;
+  lastCR = false;
+  dataLength = 0;
+  dataOverflow = false;
+  typeLength = 0;
+  idLength = strlen(lastId);
+  memcpy(id, lastId, idLength);
+
+  return true;
+}
+
+
+
+// Closes the stream and schedules the reconnect, after the retry delay doubled for every attempt that failed since the last data
+void HTTPEventSource::disconnect() {
+  client.stop();
+  open = false;
+  disconnectedAt = millis();
+
+  reconnectDelay = retryDelay;
+
+  for (uint8_t i = 0; i < failures && reconnectDelay < maxDelay; ++i) {
+    reconnectDelay *= 2;
+  }
+
+  if (reconnectDelay > maxDelay) {
+    reconnectDelay = maxDelay;
+  }
+
+  if (failures < 255) {
+    ++failures;
+  }
+}
+
+
+
+// Feeds one byte of the stream into the line parser, lines end with \r\n, \n or \r
+void HTTPEventSource::parse(uint8_t c) {
+  if (c == '\n' && lastCR) {
+    lastCR = false;
+    return;
+  }
+
+  lastCR = c == '\r';
+
+  if (c == '\r' || c == '\n') {
+    endLine();
+    return;
+  }
+
+  if (field == EventField::FieldNone) {
+    if (c == ':') {
+      beginField();
+      skipSpace = true;
+    } else if (nameLength < sizeof(name)) {
+      name[nameLength++] = c;
+    }
+    return;
+  }
+
+  if (skipSpace) {
+    skipSpace = false;
+
+    if (c == ' ') {
+      return;
+    }
+  }
+
+  switch (field) {
+    case EventField::FieldData:
+      if (dataLength < HTTP_EVENT_DATA_SIZE) {
+        data[dataLength++] = c;
+      } else {
+        dataOverflow = true;
+      }
+      break;
+
+    case EventField::FieldEvent:
+      if (typeLength < HTTP_EVENT_FIELD_SIZE) {
+        type[typeLength++] = c;
+      }
+      break;
+
+    case EventField::FieldId:
+      if (c == '\0') {
+        nextIdNull = true;
+      } else if (nextIdLength < HTTP_EVENT_FIELD_SIZE) {
+        nextId[nextIdLength++] = c;
+      }
+      break;
+
+    case EventField::FieldRetry:
+      // Only ASCII digits make a retry time, anything else and the field is ignored. Huge values stop growing, they end up at the maximum anyway
+      if (c >= '0' && c <= '9' && retryValue != -2) {
+        if (retryValue < 100000000) {
+          retryValue = ((retryValue < 0) ? 0 : retryValue) * 10 + (c - '0');
+        }
+      } else {
+        retryValue = -2;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+
+// Works out which field the name read so far is, a line starting with a colon is a comment
+void HTTPEventSource::beginField() {
+  static const struct { const char* name; EventField field; } fields[] = {
+    { "data", EventField::FieldData },
+    { "event", EventField::FieldEvent },
+    { "id", EventField::FieldId },
+    { "retry", EventField::FieldRetry },
+  };
+
+  field = EventField::FieldIgnored;
+
+  for (const auto& known : fields) {
+    if (nameLength == strlen(known.name) && memcmp(name, known.name, nameLength) == 0) {
+      field = known.field;
+      break;
+    }
+  }
+
+  // event, id and retry replace what came before, data lines add up
+  switch (field) {
+    case EventField::FieldEvent: typeLength = 0; break;
+    case EventField::FieldId: nextIdLength = 0; nextIdNull = false; break;
+    case EventField::FieldRetry: retryValue = -1; break;
+    default: break;
+  }
+}
+
+
+
+void HTTPEventSource::endLine() {
+  if (field == EventField::FieldNone) {
+    if (nameLength == 0) {
+      dispatch();
+      return;
+    }
+
+    // A field name without a colon has an empty value
+    beginField();
+  }
+
+  if (field == EventField::FieldData) {
+    if (dataLength < HTTP_EVENT_DATA_SIZE) {
+      data[dataLength++] = '\n';
+    } else {
+      dataOverflow = true;
+    }
+  } else if (field == EventField::FieldId && !nextIdNull) {
+    memcpy(id, nextId, nextIdLength);
+    idLength = nextIdLength;
+  } else if (field == EventField::FieldRetry && retryValue >= 0) {
+    retryDelay = retryValue;
+
+    if (retryDelay < minDelay) {
+      retryDelay = minDelay;
+    } else if (retryDelay > maxDelay) {
+      retryDelay = maxDelay;
+    }
+  }
+
+  field = EventField::FieldNone;
+  nameLength = 0;
+  skipSpace = false;
+}
+
+
+
+// An empty line ends the event, it is dispatched when it has data
+void HTTPEventSource::dispatch() {
+  // Even an event without data moves the id a reconnect resumes from
+  memcpy(lastId, id, idLength);
+  lastId[idLength] = '\0';
+
+  if (dataOverflow) {
+    Serial.printf(F("[HTTPEventSource] Dropping an event larger than %u bytes\n"), (unsigned)HTTP_EVENT_DATA_SIZE);
+  } else if (dataLength > 0) {
+    // The line ending after the last data line is not part of the data
+    data[--dataLength] = '\0';
+    type[typeLength] = '\0';
+
+    HTTPEvent event = { (typeLength > 0) ? type : "message", data, dataLength, lastId };
+
+    if (callback) {
+      callback(event);
+    }
+  }
+
+  dataLength = 0;
+  dataOverflow = false;
+  typeLength = 0;
+}
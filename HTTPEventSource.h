@@ -0,0 +1,126 @@
+#ifndef HTTP_EVENT_SOURCE_H
+#define HTTP_EVENT_SOURCE_H
+
+
+
+#include <Arduino.h>
+
+#include "HTTPClient.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+
+
+// Longest data an event can carry, longer events are dropped
+#ifndef HTTP_EVENT_DATA_SIZE
+#define HTTP_EVENT_DATA_SIZE 1024
+#endif
+
+// Longest event type and event id, longer ones are cut off
+#ifndef HTTP_EVENT_FIELD_SIZE
+#define HTTP_EVENT_FIELD_SIZE 64
+#endif
+
+
+
+struct HTTPEvent {
+  const char* type;     // "message" unless the event named one
+  const char* data;     // the data lines joined with \n, null terminated
+  size_t length;
+  const char* id;       // the last event id, "" when there is none
+};
+
+typedef std::function<void(const HTTPEvent& event)> HTTPEventCallback;
+
+
+
+// Subscribes to a Server-Sent Events stream (text/event-stream) and dispatches its events as they arrive.
+// The stream is parsed byte by byte from what has arrived into fixed buffers, the loop is never held up waiting for the next event.
+// A dropped stream is reopened after the server's retry: delay, doubling upto the maximum retry delay while attempts keep failing,
+// with Last-Event-ID so the server can resume where it left off.
+// The client is used for the stream only while it is open
+class HTTPEventSource
+{
+public:
+  HTTPEventSource(HTTPClient& client, const char* hostname, uint16_t port, const char* path);
+
+  void onEvent(HTTPEventCallback callback) { this->callback = callback; }
+  void setMaxRetryDelay(unsigned long maxDelay) { this->maxDelay = maxDelay; }
+  // A server's retry: below this (1000 ms by default) is raised to it, so a misbehaving server can not make it reconnect in a tight loop
+  void setMinRetryDelay(unsigned long minDelay) { this->minDelay = minDelay; }
+  // Reopen a stream nothing (not even a comment) arrived on for this long, 0 (the default) waits for the connection to close
+  void setIdleTimeout(unsigned long timeout) { idleTimeout = timeout; }
+
+  // Call from the loop, opens the stream when a (re)connect is due and dispatches the events that arrived.
+  // Returns true while the stream is open
+  bool poll();
+  // Closes the stream and stops reconnecting until poll is called after start()
+  void stop();
+  void start() { stopped = false; }
+
+  bool connected() const { return open; }
+  const char* lastEventId() const { return lastId; }
+
+protected:
+  bool connect();
+  void disconnect();
+  void parse(uint8_t c);
+  void beginField();
+  void endLine();
+  void dispatch();
+
+protected:
+  typedef enum EEventField : uint8_t {
+    FieldNone,        // reading the field name
+    FieldData,
+    FieldEvent,
+    FieldId,
+    FieldRetry,
+    FieldIgnored,     // comments and unknown fields
+  } EventField;
+
+  HTTPClient& client;
+  const char* hostname;
+  uint16_t port;
+  String path;
+  HTTPEventCallback callback;
+
+  bool open = false;
+  bool stopped = false;
+  unsigned long retryDelay = 3000;    // the server's retry:, the delay before the first reconnect
+  unsigned long minDelay = 1000;
+  unsigned long maxDelay = 60000;
+  unsigned long reconnectDelay = 0;   // delay before the next connect, 0 connects straight away
+  uint8_t failures = 0;               // reconnects since the stream last delivered anything
+  unsigned long disconnectedAt = 0;
+  unsigned long idleTimeout = 0;
+  unsigned long receivedAt = 0;
+
+  // Line parser
+  EventField field = EventField::FieldNone;
+  char name[8];
+  uint8_t nameLength = 0;
+  bool skipSpace = false;     // a single space after the colon is not part of the value
+  bool lastCR = false;        // a line ended with \r, a \n right after it belongs to that line ending
+  long int retryValue = -1;   // -1 while there are no digits, -2 once something else came
+
+  // Event being assembled
+  char data[HTTP_EVENT_DATA_SIZE + 1];
+  size_t dataLength = 0;
+  bool dataOverflow = false;
+  char type[HTTP_EVENT_FIELD_SIZE + 1];
+  size_t typeLength = 0;
+  char id[HTTP_EVENT_FIELD_SIZE + 1];
+  size_t idLength = 0;
+  char lastId[HTTP_EVENT_FIELD_SIZE + 1];
+  // An id field is collected here and replaces id at the end of its line, unless it held a NUL
+  char nextId[HTTP_EVENT_FIELD_SIZE];
+  size_t nextIdLength = 0;
+  bool nextIdNull = false;
+};
+
+
+
+#endif // HTTP_EVENT_SOURCE_H
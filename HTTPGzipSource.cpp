@@ -0,0 +1,403 @@
+#include "HTTPGzipSource.h"
+
+
+
+static_assert((HTTP_GZIP_WINDOW & (HTTP_GZIP_WINDOW - 1)) == 0 && HTTP_GZIP_WINDOW >= 512 && HTTP_GZIP_WINDOW <= 16384,
+  "HTTP_GZIP_WINDOW must be a power of two between 512 and 16384");
+
+// Deflate's length (codes 257 - 285) and distance (codes 0 - 29) bases and extra bits, RFC 1951 section 3.2.5
+static const uint16_t lengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t lengthExtra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t distanceBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distanceExtra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// CRC-32 (IEEE) four bits at a time
+static const uint32_t crcTable[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+  crc = ~crc;
+
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ crcTable[crc & 0x0F];
+    crc = (crc >> 4) ^ crcTable[crc & 0x0F];
+  }
+
+  return ~crc;
+}
+
+static uint16_t reverseBits(uint16_t code, uint8_t length) {
+  uint16_t reversed = 0;
+
+  for (uint8_t i = 0; i < length; ++i) {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+
+  return reversed;
+}
+
+
+
+HTTPGzipSource::HTTPGzipSource(HTTPBodySource& source) :
+  source(source)
+{
+  reset();
+}
+
+
+
+void HTTPGzipSource::reset() {
+  position = end = 0;
+  inputEnded = false;
+  stage = GzipStage::GzipHeader;
+  crc = 0;
+  inputSize = 0;
+  bitBuffer = 0;
+  bitCount = 0;
+  spillStart = spillLength = 0;
+
+  memset(head, 0xFF, sizeof(head));
+  memset(prev, 0xFF, sizeof(prev));
+}
+
+
+
+bool HTTPGzipSource::rewind() {
+  if (!source.rewind()) {
+    return false;
+  }
+
+  reset();
+  return true;
+}
+
+
+
+/**
+ * @brief Compresses the body once to count its compressed length, then rewinds.
+ * A wrapped source with nothing ready yet is waited for, upto timeout ms without progress.
+ *
+ * @return false if the wrapped source can not rewind, failed, or had nothing ready for timeout ms
+ */
+bool HTTPGzipSource::measure(unsigned long timeout) {
+  uint8_t scratch[64];
+  unsigned long progressAt = millis();
+  long int total = 0;
+  long int n;
+
+  measured = -1;
+
+  if (!rewind()) {
+    return false;
+  }
+
+  while ((n = read(scratch, sizeof(scratch))) >= 0) {
+    if (n > 0) {
+      total += n;
+      progressAt = millis();
+    } else if (millis() - progressAt >= timeout) {
+      break;
+    } else {
+      yield();
+    }
+  }
+
+  if (n != HTTP_SOURCE_END || !rewind()) {
+    Serial.println(F("[HTTPGzipSource] Could not measure the compressed body"));
+    return false;
+  }
+
+  measured = total;
+  return true;
+}
+
+
+
+/**
+ * @brief Compresses as much of the wrapped source as fits into buffer.
+ * Every symbol is written whole, so the buffer is filled upto a few bytes short of its capacity.
+ * Buffers too small for the header or the trailer are served from the spill buffer, a few bytes at a time.
+ *
+ * @return The number of bytes written, 0 when the wrapped source has nothing ready yet, HTTP_SOURCE_END or HTTP_SOURCE_ERROR
+ */
+long int HTTPGzipSource::read(uint8_t* buffer, size_t capacity) {
+  if (spillStart == spillLength && capacity < sizeof(spill)) {
+    long int r = compress(spill, sizeof(spill));
+
+    if (r <= 0) {
+      return r;
+    }
+
+    spillStart = 0;
+    spillLength = r;
+  }
+
+  if (spillStart < spillLength) {
+    size_t n = spillLength - spillStart;
+
+    if (n > capacity) {
+      n = capacity;
+    }
+
+    memcpy(buffer, spill + spillStart, n);
+    spillStart += n;
+
+    return n;
+  }
+
+  return compress(buffer, capacity);
+}
+
+
+
+// The encoder behind read, capacity must hold the header or trailer for those to be written
+long int HTTPGzipSource::compress(uint8_t* buffer, size_t capacity) {
+  // The longest symbol with its extra bits, plus the bits left over from the previous one
+  static const size_t symbolRoom = 6;
+  size_t length, distance;
+  long int r;
+
+  out = buffer;
+  outLength = 0;
+
+  if (stage == GzipStage::GzipDone) {
+    return HTTP_SOURCE_END;
+  }
+
+  if (stage == GzipStage::GzipHeader) {
+    if (capacity < 10 + symbolRoom) {
+      return 0;
+    }
+
+    // ID1 ID2, deflate, no flags, no modification time, no extra flags, unknown OS
+    static const uint8_t header[10] = { 0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF };
+    memcpy(out, header, sizeof(header));
+    outLength = sizeof(header);
+
+    // A single final block with the fixed Huffman codes carries the whole body
+    putBits(1, 1);
+    putBits(1, 2);
+
+    stage = GzipStage::GzipBody;
+  }
+
+  while (stage == GzipStage::GzipBody && capacity - outLength >= symbolRoom) {
+    if (end - position < minLookahead && !inputEnded) {
+      r = fillWindow();
+
+      if (r == HTTP_SOURCE_ERROR) {
+        return HTTP_SOURCE_ERROR;
+      }
+
+      // Wait for more rather than compressing the little there is badly
+      if (r == 0 && !inputEnded && end - position < minLookahead) {
+        break;
+      }
+    }
+
+    if (position == end) {
+      if (inputEnded) {
+        putSymbol(256);
+        stage = GzipStage::GzipTrailer;
+      }
+      break;
+    }
+
+    length = longestMatch(distance);
+
+    if (length >= 3) {
+      putMatch(length, distance);
+
+      for (size_t i = 0; i < length; ++i) {
+        insertHash(position++);
+      }
+    } else {
+      putSymbol(window[position]);
+      insertHash(position++);
+    }
+  }
+
+  // What is left of the last byte, then the CRC and size of the uncompressed data
+  if (stage == GzipStage::GzipTrailer && capacity - outLength >= 1 + 8) {
+    if (bitCount > 0) {
+      putBits(0, 8 - bitCount);
+    }
+
+    for (uint8_t i = 0; i < 4; ++i) {
+      putByte(crc >> (8 * i));
+    }
+    for (uint8_t i = 0; i < 4; ++i) {
+      putByte(inputSize >> (8 * i));
+    }
+
+    stage = GzipStage::GzipDone;
+  }
+
+  if (outLength == 0 && stage == GzipStage::GzipDone) {
+    return HTTP_SOURCE_END;
+  }
+
+  return outLength;
+}
+
+
+
+// Slides the window down once its upper half is reached and reads more of the wrapped source into it
+// returns the number of bytes read, 0 when the source had nothing or HTTP_SOURCE_ERROR
+long int HTTPGzipSource::fillWindow() {
+  if (end == sizeof(window) && position >= HTTP_GZIP_WINDOW) {
+    memmove(window, window + HTTP_GZIP_WINDOW, end - HTTP_GZIP_WINDOW);
+    position -= HTTP_GZIP_WINDOW;
+    end -= HTTP_GZIP_WINDOW;
+
+    for (uint16_t& entry : head) {
+      entry = (entry != nil && entry >= HTTP_GZIP_WINDOW) ? entry - HTTP_GZIP_WINDOW : nil;
+    }
+    for (uint16_t& entry : prev) {
+      entry = (entry != nil && entry >= HTTP_GZIP_WINDOW) ? entry - HTTP_GZIP_WINDOW : nil;
+    }
+  }
+
+  if (end == sizeof(window)) {
+    return 0;
+  }
+
+  long int r = source.read(window + end, sizeof(window) - end);
+
+  if (r == HTTP_SOURCE_END) {
+    inputEnded = true;
+    return 0;
+  }
+
+  if (r < 0) {
+    return HTTP_SOURCE_ERROR;
+  }
+
+  crc = crc32Update(crc, window + end, r);
+  inputSize += r;
+  end += r;
+
+  return r;
+}
+
+
+
+// Multiplicative hash of the next three bytes
+static inline size_t hashAt(const uint8_t* p) {
+  return (((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u) >> (32 - HTTP_GZIP_HASH_BITS);
+}
+
+
+
+void HTTPGzipSource::insertHash(size_t at) {
+  if (at + 3 > end) {
+    return;
+  }
+
+  size_t h = hashAt(window + at);
+
+  prev[at & (HTTP_GZIP_WINDOW - 1)] = head[h];
+  head[h] = at;
+}
+
+
+
+// Follows the hash chain for the longest earlier match of the bytes at position, returns its length (0 for none)
+size_t HTTPGzipSource::longestMatch(size_t& distance) {
+  // Candidates further back than this may have had their chain entry overwritten
+  static const size_t maxDistance = HTTP_GZIP_WINDOW - minLookahead;
+  size_t available = end - position;
+  size_t best = 0;
+
+  if (available < 3) {
+    return 0;
+  }
+
+  if (available > 258) {
+    available = 258;
+  }
+
+  size_t limit = (position > maxDistance) ? position - maxDistance : 0;
+  size_t candidate = head[hashAt(window + position)];
+  const uint8_t* current = window + position;
+
+  for (uint8_t chain = 0; chain < HTTP_GZIP_MAX_CHAIN && candidate != nil && candidate < position && candidate >= limit; ++chain) {
+    const uint8_t* match = window + candidate;
+
+    if (match[best] == current[best] && match[0] == current[0]) {
+      size_t n = 0;
+
+      while (n < available && match[n] == current[n]) {
+        ++n;
+      }
+
+      if (n > best) {
+        best = n;
+        distance = position - candidate;
+
+        if (n == available) {
+          break;
+        }
+      }
+    }
+
+    candidate = prev[candidate & (HTTP_GZIP_WINDOW - 1)];
+  }
+
+  return best;
+}
+
+
+
+// Bits go out least significant first, whole bytes as soon as there are some
+void HTTPGzipSource::putBits(uint32_t value, uint8_t count) {
+  bitBuffer |= value << bitCount;
+  bitCount += count;
+
+  while (bitCount >= 8) {
+    putByte(bitBuffer);
+    bitBuffer >>= 8;
+    bitCount -= 8;
+  }
+}
+
+
+
+// A literal/length symbol with the fixed Huffman code, RFC 1951 section 3.2.6
+void HTTPGzipSource::putSymbol(uint16_t symbol) {
+  if (symbol < 144) {
+    putBits(reverseBits(0x30 + symbol, 8), 8);
+  } else if (symbol < 256) {
+    putBits(reverseBits(0x190 + symbol - 144, 9), 9);
+  } else if (symbol < 280) {
+    putBits(reverseBits(symbol - 256, 7), 7);
+  } else {
+    putBits(reverseBits(0xC0 + symbol - 280, 8), 8);
+  }
+}
+
+
+
+void HTTPGzipSource::putMatch(size_t length, size_t distance) {
+  uint8_t code = 28;
+
+  while (lengthBase[code] > length) {
+    --code;
+  }
+
+  putSymbol(257 + code);
+  putBits(length - lengthBase[code], lengthExtra[code]);
+
+  code = 29;
+
+  while (distanceBase[code] > distance) {
+    --code;
+  }
+
+  putBits(reverseBits(code, 5), 5);
+  putBits(distance - distanceBase[code], distanceExtra[code]);
+}
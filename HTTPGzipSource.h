@@ -0,0 +1,100 @@
+#ifndef HTTP_GZIP_SOURCE_H
+#define HTTP_GZIP_SOURCE_H
+
+
+
+#include <Arduino.h>
+
+#include "HTTPBodySource.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+
+// Sliding window the encoder looks back into for matches, a power of two between 512 and 16384.
+// RAM use is about 4 * HTTP_GZIP_WINDOW + 2 << HTTP_GZIP_HASH_BITS bytes
+#ifndef HTTP_GZIP_WINDOW
+#define HTTP_GZIP_WINDOW 1024
+#endif
+
+#ifndef HTTP_GZIP_HASH_BITS
+#define HTTP_GZIP_HASH_BITS 9
+#endif
+
+// Candidates looked at for every match, more compresses better and slower
+#ifndef HTTP_GZIP_MAX_CHAIN
+#define HTTP_GZIP_MAX_CHAIN 16
+#endif
+
+
+
+// Compresses another body source into a gzip stream while it is being sent, with Content-Encoding: gzip.
+// Deflate with greedy LZ77 matching over a small window and the fixed Huffman codes, so it needs no per block tables.
+// The length is not known up front so the body is sent chunked, unless measure() compressed it once beforehand to count it.
+class HTTPGzipSource : public HTTPBodySource
+{
+public:
+  HTTPGzipSource(HTTPBodySource& source);
+
+  virtual long int read(uint8_t* buffer, size_t capacity) override;
+  virtual long int length() const override { return measured; }
+  virtual bool rewind() override;
+  virtual const char* contentEncoding() const override { return "gzip"; }
+  virtual const char* contentType() const override { return source.contentType(); }
+
+  // Compresses the whole body once, without sending it, to learn its compressed length for Content-Length.
+  // The wrapped source must be able to rewind, false if it can not, failed or had nothing ready for timeout ms
+  bool measure(unsigned long timeout = 5000);
+
+protected:
+  void reset();
+  long int compress(uint8_t* buffer, size_t capacity);
+  long int fillWindow();
+  size_t longestMatch(size_t& distance);
+  void insertHash(size_t position);
+  void putBits(uint32_t value, uint8_t count);
+  void putSymbol(uint16_t symbol);
+  void putMatch(size_t length, size_t distance);
+  void putByte(uint8_t value) { out[outLength++] = value; }
+
+protected:
+  static const size_t minLookahead = 258 + 3 + 1;
+  static const uint16_t nil = 0xFFFF;
+
+  typedef enum EGzipStage : uint8_t {
+    GzipHeader,
+    GzipBody,
+    GzipTrailer,
+    GzipDone,
+  } GzipStage;
+
+  HTTPBodySource& source;
+  long int measured = -1;
+
+  uint8_t window[2 * HTTP_GZIP_WINDOW];
+  uint16_t head[1 << HTTP_GZIP_HASH_BITS];
+  uint16_t prev[HTTP_GZIP_WINDOW];
+  size_t position;
+  size_t end;
+  bool inputEnded;
+
+  GzipStage stage;
+  uint32_t crc;
+  uint32_t inputSize;
+  uint32_t bitBuffer;
+  uint8_t bitCount;
+
+  // The buffer of the read in progress
+  uint8_t* out;
+  size_t outLength;
+
+  // Reads smaller than the header, a symbol or the trailer are compressed in here and handed out piece by piece
+  uint8_t spill[16];
+  uint8_t spillStart;
+  uint8_t spillLength;
+};
+
+
+
+#endif // HTTP_GZIP_SOURCE_H
@@ -0,0 +1,56 @@
+#include "HTTPHeaderSet.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+
+/**
+ * @brief Appends "name: value\r\n" to the block.
+ *
+ * @return false, leaving the set unchanged, if it does not fit or the name or value are not valid in a header line
+ */
+bool HTTPHeaderSet::add(const char* name, const char* value) {
+  if (name == nullptr || name[0] == '\0') {
+    return false;
+  }
+
+  if (value == nullptr) {
+    value = "";
+  }
+
+  size_t nameLength = strlen(name);
+  size_t valueLength = strlen(value);
+
+  // A stray line break would let a value inject headers of its own
+  if (strpbrk(name, ": \t\r\n") != nullptr || strpbrk(value, "\r\n") != nullptr) {
+    Serial.printf(F("[HTTPHeaderSet] Refusing the malformed header %s\n"), name);
+    return false;
+  }
+
+  if (used + nameLength + 2 + valueLength + 2 > sizeof(block)) {
+    Serial.printf(F("[HTTPHeaderSet] No room for the header %s\n"), name);
+    return false;
+  }
+
+  memcpy(block + used, name, nameLength);
+  used += nameLength;
+  block[used++] = ':';
+  block[used++] = ' ';
+  memcpy(block + used, value, valueLength);
+  used += valueLength;
+  block[used++] = '\r';
+  block[used++] = '\n';
+
+  return true;
+}
+
+
+
+bool HTTPHeaderSet::add(const char* name, long value) {
+  char number[12];
+
+  snprintf(number, sizeof(number), "%ld", value);
+
+  return add(name, number);
+}
@@ -0,0 +1,52 @@
+#ifndef HTTP_HEADER_SET_H
+#define HTTP_HEADER_SET_H
+
+
+
+#include <Arduino.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+
+// Bytes of serialized header lines a HTTPHeaderSet can hold
+#ifndef HTTP_HEADER_SET_SIZE
+#define HTTP_HEADER_SET_SIZE 256
+#endif
+
+
+
+// Header lines serialized once into a contiguous, CRLF terminated block that is written with a single write.
+// A set can extend another one by reference, e.g. a per request set adding to the set shared by every request,
+// the base must outlive the sets extending it.
+//
+//   HTTPHeaderSet common;
+//   common.add("Authorization", "Bearer abc");
+//   common.add("User-Agent", "TeHTTPClient");
+//
+//   HTTPHeaderSet request(&common);
+//   request.add("X-Request-Id", 42);
+class HTTPHeaderSet
+{
+public:
+  HTTPHeaderSet(const HTTPHeaderSet* base = nullptr) : parent(base) {}
+
+  // false if the set is full or the name or value would break the header block (empty name, CR, LF, ':' in the name)
+  bool add(const char* name, const char* value);
+  bool add(const char* name, long value);
+  void clear() { used = 0; }
+
+  const uint8_t* data() const { return block; }
+  size_t length() const { return used; }
+  const HTTPHeaderSet* base() const { return parent; }
+
+protected:
+  uint8_t block[HTTP_HEADER_SET_SIZE];
+  size_t used = 0;
+  const HTTPHeaderSet* parent;
+};
+
+
+
+#endif // HTTP_HEADER_SET_H
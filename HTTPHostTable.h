@@ -0,0 +1,66 @@
+#ifndef HTTP_HOST_TABLE_H
+#define HTTP_HOST_TABLE_H
+
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+
+// Fixed size table of per host entries, keyed by HTTPRttEstimator::hostKey.
+// A host not seen before takes over the least recently used slot, so the table never grows.
+// Entry needs a uint32_t key, 0 for an unused slot, and a uint32_t lastUsed.
+template<typename Entry, size_t Size>
+class HTTPHostTable
+{
+  static_assert(Size > 0, "HTTPHostTable needs at least one slot");
+
+public:
+  // nullptr when the host has not been seen
+  const Entry* find(uint32_t key) const
+  {
+    for (const Entry& host : hosts)
+    {
+      if (host.key == key)
+      {
+        return &host;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Finds the host's entry, taking over the least recently used slot for hosts not seen before
+  Entry& entry(uint32_t key)
+  {
+    Entry* oldest = &hosts[0];
+
+    for (Entry& host : hosts)
+    {
+      if (host.key == key)
+      {
+        host.lastUsed = ++clock;
+        return host;
+      }
+      if (host.lastUsed < oldest->lastUsed)
+      {
+        oldest = &host;
+      }
+    }
+
+    *oldest = Entry();
+    oldest->key = key;
+    oldest->lastUsed = ++clock;
+
+    return *oldest;
+  }
+
+private:
+  Entry hosts[Size];
+  uint32_t clock = 0;
+};
+
+
+
+#endif // HTTP_HOST_TABLE_H
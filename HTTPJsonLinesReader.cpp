@@ -0,0 +1,161 @@
+#include "HTTPJsonLinesReader.h"
+
+
+
+void HTTPJsonLinesReader::reset() {
+  end = 0;
+  discarding = false;
+  recordCount = 0;
+  skippedCount = 0;
+}
+
+
+
+long int HTTPJsonLinesReader::read(HTTPClient& client, HTTPJsonLineCallback callback) {
+  long int r;
+  size_t from;
+
+  for (;;) {
+    from = end;
+    r = client.readAvailable((uint8_t*)buffer + end, sizeof(buffer) - end);
+
+    if (r < 0) {
+      break;
+    }
+
+    // Nothing buffered, wait as the client's blocking reads do. A closed connection ends the body on the next read
+    if (r == 0) {
+      if (client.waitForData() == 0 && client.connected()) {
+        Serial.println(client.isCancelled() ? F("[HTTPJsonLinesReader] Cancelled") : F("[HTTPJsonLinesReader] No data, giving up"));
+        return -1;
+      }
+
+      continue;
+    }
+
+    end += r;
+
+    if (!process(from, callback)) {
+      return -1;
+    }
+  }
+
+  if (!finish(callback)) {
+    return -1;
+  }
+
+  return recordCount;
+}
+
+
+
+bool HTTPJsonLinesReader::feed(const uint8_t* data, size_t length, HTTPJsonLineCallback callback) {
+  size_t n, from;
+
+  while (length > 0) {
+    n = sizeof(buffer) - end;
+    if (n > length) {
+      n = length;
+    }
+
+    from = end;
+    memcpy(buffer + end, data, n);
+    end += n;
+    data += n;
+    length -= n;
+
+    if (!process(from, callback)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+
+bool HTTPJsonLinesReader::finish(HTTPJsonLineCallback callback) {
+  bool ok = discarding || parseLine(buffer, end, callback);
+
+  end = 0;
+  discarding = false;
+
+  return ok;
+}
+
+
+
+/**
+ * @brief Parses every complete line in the buffer, the new data starts at from so only it is searched for line endings.
+ * What is left of an unfinished line is moved to the front, a line filling the whole buffer is dropped upto its line ending.
+ *
+ * @return false if the callback stopped
+ */
+bool HTTPJsonLinesReader::process(size_t from, HTTPJsonLineCallback& callback) {
+  const char* line = buffer;
+  const char* newline;
+
+  while ((newline = (const char*)httpFindByte((const uint8_t*)buffer + from, (const uint8_t*)buffer + end, '\n')) < buffer + end) {
+    if (discarding) {
+      discarding = false;
+    } else if (!parseLine(line, newline - line, callback)) {
+      return false;
+    }
+
+    line = newline + 1;
+    from = line - buffer;
+  }
+
+  end -= line - buffer;
+  memmove(buffer, line, end);
+
+  if (end == sizeof(buffer)) {
+    if (!discarding) {
+      Serial.printf(F("[HTTPJsonLinesReader] Skipping a record longer than %u bytes\n"), (unsigned)sizeof(buffer));
+      ++skippedCount;
+    }
+
+    discarding = true;
+    end = 0;
+  }
+
+  return true;
+}
+
+
+
+bool HTTPJsonLinesReader::parseLine(const char* line, size_t length, HTTPJsonLineCallback& callback) {
+  DeserializationError err;
+
+  while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t')) {
+    --length;
+  }
+
+  if (length == 0) {
+    return true;
+  }
+
+  // Read only input, the document copies the strings it keeps since the buffer is reused for the next line
+  if (filter != nullptr) {
+    err = deserializeJson(document, line, length, DeserializationOption::Filter(*filter));
+  } else {
+    err = deserializeJson(document, line, length);
+  }
+
+  if (err) {
+    Serial.print(F("[HTTPJsonLinesReader] Skipping a record that does not parse: "));
+    Serial.println(err.f_str());
+
+    ++skippedCount;
+    return true;
+  }
+
+  ++recordCount;
+
+  if (!callback(document)) {
+    Serial.println(F("[HTTPJsonLinesReader] Stopped by the callback"));
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,72 @@
+#ifndef HTTP_JSON_LINES_READER_H
+#define HTTP_JSON_LINES_READER_H
+
+
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "HTTPClient.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+
+
+// Longest record a HTTPJsonLinesReader can parse, longer lines are skipped
+#ifndef HTTP_JSON_LINE_SIZE
+#define HTTP_JSON_LINE_SIZE 512
+#endif
+
+
+
+// Called with every record, deserialized into the reader's document. Return false to stop reading
+typedef std::function<bool(JsonDocument& record)> HTTPJsonLineCallback;
+
+
+
+// Streams a newline delimited JSON (NDJSON, JSON lines) body record by record.
+// The body is read into a fixed line buffer, lines split across reads or chunks are completed in place, and every line is
+// deserialized into the same document before the callback sees it, so memory stays the same however many records arrive.
+// Blank lines are ignored, lines that are too long or do not parse are skipped and counted
+class HTTPJsonLinesReader
+{
+public:
+  HTTPJsonLinesReader(JsonDocument& document) : document(document) {}
+
+  // Only keep the fields the filter has, see ArduinoJson's DeserializationOption::Filter. nullptr (the default) keeps everything
+  void setFilter(const JsonDocument* filter) { this->filter = filter; }
+
+  // Reads the rest of the response body through the client, handing over each record as soon as its line is complete.
+  // Waits between records are bounded like the client's own reads: its timeout or idle deadline, its body deadline and its cancellation token.
+  // Returns the number of records, or -1 if the callback stopped the read, the body stalled or the read was cancelled
+  long int read(HTTPClient& client, HTTPJsonLineCallback callback);
+
+  // Parses a piece of a body read some other way, finish() parses a last line without a line ending.
+  // false once the callback stopped
+  bool feed(const uint8_t* data, size_t length, HTTPJsonLineCallback callback);
+  bool finish(HTTPJsonLineCallback callback);
+
+  size_t records() const { return recordCount; }
+  size_t skipped() const { return skippedCount; }
+  void reset();
+
+protected:
+  bool process(size_t from, HTTPJsonLineCallback& callback);
+  bool parseLine(const char* line, size_t length, HTTPJsonLineCallback& callback);
+
+protected:
+  JsonDocument& document;
+  const JsonDocument* filter = nullptr;
+
+  char buffer[HTTP_JSON_LINE_SIZE];
+  size_t end = 0;
+  bool discarding = false;    // the line did not fit, dropping it upto its line ending
+  size_t recordCount = 0;
+  size_t skippedCount = 0;
+};
+
+
+
+#endif // HTTP_JSON_LINES_READER_H
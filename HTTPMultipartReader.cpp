@@ -0,0 +1,369 @@
+#include "HTTPMultipartReader.h"
+
+
+
+static_assert(HTTP_MULTIPART_BUFFER_SIZE >= 4 * (4 + HTTP_MULTIPART_MAX_BOUNDARY), "HTTP_MULTIPART_BUFFER_SIZE is too small for the longest boundary");
+
+// Case insensitive check of text starting with a lower case literal
+static bool startsWithLower(const char* text, size_t length, const char* literal) {
+  size_t i = 0;
+
+  for (; literal[i] != '\0'; ++i) {
+    if (i == length || tolower((unsigned char)text[i]) != literal[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Reads a decimal number starting right at text, strtoul alone would skip whitespace and line endings to find one.
+// false if text does not start with a digit or the number runs past end
+static bool readNumber(const char* text, const char* end, unsigned long& value, const char*& next) {
+  char* stop;
+
+  if (text >= end || *text < '0' || *text > '9') {
+    return false;
+  }
+
+  value = strtoul(text, &stop, 10);
+  next = stop;
+
+  return next > text && next <= end;
+}
+
+
+
+/**
+ * @brief Takes the boundary from a multipart Content-Type value, quoted or not, and prepares the search for it.
+ *
+ * @return false if the type is not multipart or has no valid boundary
+ */
+bool HTTPMultipartReader::begin(const char* contentType) {
+  size_t length = (contentType != nullptr) ? strlen(contentType) : 0;
+  const char* boundary = nullptr;
+  size_t n = 0;
+
+  state = ReaderState::ReaderFailed;
+
+  if (!startsWithLower(contentType, length, "multipart/")) {
+    Serial.println(F("[HTTPMultipartReader] Response is not multipart"));
+    return false;
+  }
+
+  for (size_t i = 0; i < length; ++i) {
+    if ((i == 0 || contentType[i - 1] == ';' || contentType[i - 1] == ' ') && startsWithLower(contentType + i, length - i, "boundary=")) {
+      boundary = contentType + i + 9;
+      break;
+    }
+  }
+
+  if (boundary != nullptr && *boundary == '"') {
+    ++boundary;
+    while (boundary[n] != '\0' && boundary[n] != '"') { ++n; }
+  } else if (boundary != nullptr) {
+    while (boundary[n] != '\0' && boundary[n] != ';' && boundary[n] != ' ' && boundary[n] != '\t') { ++n; }
+  }
+
+  if (n == 0 || n > HTTP_MULTIPART_MAX_BOUNDARY) {
+    Serial.println(F("[HTTPMultipartReader] Missing or invalid boundary"));
+    return false;
+  }
+
+  // Every boundary but the first follows a line ending, reset() puts one in front of the body so the first matches too
+  memcpy(delimiter, "\r\n--", 4);
+  memcpy(delimiter + 4, boundary, n);
+  delimiterLength = 4 + n;
+  delimiter[delimiterLength] = '\0';
+
+  // Horspool's shift for every byte, how far the delimiter can move when that byte is under its last position
+  memset(skip, delimiterLength, sizeof(skip));
+  for (size_t i = 0; i + 1 < delimiterLength; ++i) {
+    skip[(uint8_t)delimiter[i]] = delimiterLength - 1 - i;
+  }
+
+  reset();
+  return true;
+}
+
+
+
+bool HTTPMultipartReader::begin(const std::vector<String>& headers) {
+  for (const String& header : headers) {
+    if (startsWithLower(header.c_str(), header.length(), "content-type:")) {
+      const char* value = header.c_str() + 13;
+      while (*value == ' ' || *value == '\t') { ++value; }
+
+      return begin(value);
+    }
+  }
+
+  Serial.println(F("[HTTPMultipartReader] Response has no Content-Type"));
+
+  state = ReaderState::ReaderFailed;
+  return false;
+}
+
+
+
+void HTTPMultipartReader::reset() {
+  buffer[0] = '\r';
+  buffer[1] = '\n';
+  start = 0;
+  end = 2;
+
+  state = ReaderState::ReaderPreamble;
+  part = HTTPResponsePart();
+  parts = 0;
+}
+
+
+
+long int HTTPMultipartReader::read(HTTPClient& client, HTTPResponsePartCallback callback) {
+  size_t r;
+
+  this->callback = callback;
+
+  while (state != ReaderState::ReaderFailed) {
+    memmove(buffer, buffer + start, end - start);
+    end -= start;
+    start = 0;
+
+    r = client.readBytes((char*)buffer + end, sizeof(buffer) - end);
+
+    if (r == 0) {
+      break;
+    }
+
+    end += r;
+    process();
+  }
+
+  if (state != ReaderState::ReaderEpilogue) {
+    Serial.println(F("[HTTPMultipartReader] Body ended before its closing boundary"));
+    return -1;
+  }
+
+  return parts;
+}
+
+
+
+bool HTTPMultipartReader::feed(const uint8_t* data, size_t length, HTTPResponsePartCallback callback) {
+  size_t n;
+
+  this->callback = callback;
+
+  while (length > 0 && state != ReaderState::ReaderFailed) {
+    memmove(buffer, buffer + start, end - start);
+    end -= start;
+    start = 0;
+
+    n = sizeof(buffer) - end;
+    if (n > length) {
+      n = length;
+    }
+
+    memcpy(buffer + end, data, n);
+    end += n;
+    data += n;
+    length -= n;
+
+    process();
+  }
+
+  return state != ReaderState::ReaderFailed;
+}
+
+
+
+/**
+ * @brief Parses as much of the buffered body as it can, consuming everything up to what needs more data.
+ * Content is delivered in place, except the last delimiter length - 1 bytes which may be the start of a boundary.
+ */
+void HTTPMultipartReader::process() {
+  const uint8_t* eol;
+  size_t n, found;
+
+  for (;;) {
+    n = end - start;
+
+    switch (state) {
+      case ReaderState::ReaderPreamble:
+      case ReaderState::ReaderBody:
+        found = findDelimiter(buffer + start, n);
+
+        if (found == n) {
+          if (n >= delimiterLength) {
+            n -= delimiterLength - 1;
+
+            if (state == ReaderState::ReaderBody && !deliver(buffer + start, n)) {
+              return;
+            }
+
+            start += n;
+          }
+          return;
+        }
+
+        if (state == ReaderState::ReaderBody) {
+          if (!deliver(buffer + start, found)) {
+            return;
+          }
+
+          part.complete = true;
+          if (!deliver(nullptr, 0)) {
+            return;
+          }
+        }
+
+        start += found + delimiterLength;
+        state = ReaderState::ReaderDelimiter;
+        break;
+
+      case ReaderState::ReaderDelimiter:
+        if (n < 2) {
+          return;
+        }
+
+        if (buffer[start] == '-' && buffer[start + 1] == '-') {
+          state = ReaderState::ReaderEpilogue;
+          break;
+        }
+
+        // The line ending may be preceded by transport padding
+        eol = httpFindCRLF(buffer + start, buffer + end);
+
+        if (eol == buffer + end) {
+          if (start == 0 && end == sizeof(buffer)) {
+            Serial.println(F("[HTTPMultipartReader] Malformed boundary line"));
+            state = ReaderState::ReaderFailed;
+          }
+          return;
+        }
+
+        start = eol - buffer + 2;
+
+        part = HTTPResponsePart();
+        part.index = parts++;
+        state = ReaderState::ReaderHeaders;
+        break;
+
+      case ReaderState::ReaderHeaders:
+        eol = httpFindCRLF(buffer + start, buffer + end);
+
+        if (eol == buffer + end) {
+          if (start == 0 && end == sizeof(buffer)) {
+            Serial.println(F("[HTTPMultipartReader] Part header line too long"));
+            state = ReaderState::ReaderFailed;
+          }
+          return;
+        }
+
+        if (eol == buffer + start) {
+          state = ReaderState::ReaderBody;
+        } else {
+          parseHeader((const char*)buffer + start, eol - (buffer + start));
+        }
+
+        start = eol - buffer + 2;
+        break;
+
+      case ReaderState::ReaderEpilogue:
+        start = end;
+        return;
+
+      default:
+        return;
+    }
+  }
+}
+
+
+
+// Boyer-Moore-Horspool search, returns the offset of the first whole delimiter or length if there is none
+size_t HTTPMultipartReader::findDelimiter(const uint8_t* data, size_t length) const {
+  const uint8_t last = delimiter[delimiterLength - 1];
+  size_t i = 0;
+  uint8_t c;
+
+  while (i + delimiterLength <= length) {
+    c = data[i + delimiterLength - 1];
+
+    if (c == last && memcmp(data + i, delimiter, delimiterLength - 1) == 0) {
+      return i;
+    }
+
+    i += skip[c];
+  }
+
+  return length;
+}
+
+
+
+// Picks the Content-Type and Content-Range (bytes 500-999/8000 or bytes 500-999/*) out of a part header line
+void HTTPMultipartReader::parseHeader(const char* line, size_t length) {
+  const char* colon = (const char*)httpFindByte((const uint8_t*)line, (const uint8_t*)line + length, ':');
+  const char* value = colon + 1;
+  const char* valueEnd = line + length;
+
+  if (colon == valueEnd) {
+    return;
+  }
+
+  while (value < valueEnd && (*value == ' ' || *value == '\t')) { ++value; }
+
+  if (startsWithLower(line, colon - line, "content-type") && colon - line == 12) {
+    size_t n = valueEnd - value;
+
+    if (n >= sizeof(part.contentType)) {
+      n = sizeof(part.contentType) - 1;
+    }
+
+    memcpy(part.contentType, value, n);
+    part.contentType[n] = '\0';
+  } else if (startsWithLower(line, colon - line, "content-range") && colon - line == 13
+      && startsWithLower(value, valueEnd - value, "bytes ")) {
+    // A malformed range is ignored, the part is then delivered without one
+    const char* next;
+    unsigned long start, end, total;
+    long int rangeTotal = -1;
+
+    if (!readNumber(value + 6, valueEnd, start, next) || next == valueEnd || *next != '-'
+        || !readNumber(next + 1, valueEnd, end, next) || end < start) {
+      return;
+    }
+
+    if (next < valueEnd && *next == '/') {
+      if (readNumber(next + 1, valueEnd, total, next)) {
+        rangeTotal = total;
+      } else if (next + 1 == valueEnd || next[1] != '*') {
+        return;
+      }
+    }
+
+    part.rangeStart = start;
+    part.rangeEnd = end;
+    part.rangeTotal = rangeTotal;
+    part.hasRange = true;
+  }
+}
+
+
+
+bool HTTPMultipartReader::deliver(const uint8_t* data, size_t length) {
+  if (length == 0 && !part.complete) {
+    return true;
+  }
+
+  if (!callback(part, data, length)) {
+    Serial.println(F("[HTTPMultipartReader] Stopped by the callback"));
+
+    state = ReaderState::ReaderFailed;
+    return false;
+  }
+
+  part.offset += length;
+  return true;
+}
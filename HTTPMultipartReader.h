@@ -0,0 +1,99 @@
+#ifndef HTTP_MULTIPART_READER_H
+#define HTTP_MULTIPART_READER_H
+
+
+
+#include <Arduino.h>
+
+#include "HTTPClient.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+
+
+// Buffer the body is searched for boundaries in, it must hold the longest part header line
+#ifndef HTTP_MULTIPART_BUFFER_SIZE
+#define HTTP_MULTIPART_BUFFER_SIZE 512
+#endif
+
+// Longest boundary RFC 2046 allows
+#define HTTP_MULTIPART_MAX_BOUNDARY 70
+
+
+
+// A part of a multipart response as far as its headers describe it
+struct HTTPResponsePart {
+  size_t index = 0;             // 0 for the first part
+  char contentType[64] = "";
+  bool hasRange = false;        // Content-Range was sent, the part holds bytes rangeStart to rangeEnd (inclusive) of the resource
+  unsigned long rangeStart = 0;
+  unsigned long rangeEnd = 0;
+  long int rangeTotal = -1;     // size of the whole resource, -1 when the server did not say
+  size_t offset = 0;            // bytes of the part delivered before this call
+  bool complete = false;        // set on the last call for the part, which carries no data
+};
+
+// Called with every piece of a part's content as it arrives, and once more with length 0 when the part ended.
+// The data lives in the reader's buffer, return false to stop reading
+typedef std::function<bool(const HTTPResponsePart& part, const uint8_t* data, size_t length)> HTTPResponsePartCallback;
+
+
+
+// Streams a multipart response body (multipart/byteranges, multipart/mixed) part by part.
+// The body is read into a fixed buffer and searched for the boundary with Boyer-Moore-Horspool,
+// holding back the bytes at its end that may be the start of a boundary split across reads.
+// One request for several ranges of a file can then be answered in a single round trip.
+class HTTPMultipartReader
+{
+public:
+  // Takes the boundary from a Content-Type value, e.g. multipart/byteranges; boundary=3d6b6a416f9b5. false if there is none
+  bool begin(const char* contentType);
+  // Takes it from the Content-Type of response headers collected through outHeaders
+  bool begin(const std::vector<String>& headers);
+
+  // Reads the rest of the response body through the client.
+  // Returns the number of parts, or -1 if the body was cut off, malformed or the callback stopped the read
+  long int read(HTTPClient& client, HTTPResponsePartCallback callback);
+
+  // Parses a piece of a body read some other way, false once the body is malformed or the callback stopped.
+  // done() tells when the closing boundary has been seen
+  bool feed(const uint8_t* data, size_t length, HTTPResponsePartCallback callback);
+  bool done() const { return state == ReaderState::ReaderEpilogue; }
+
+protected:
+  typedef enum EReaderState : uint8_t {
+    ReaderPreamble,     // before the first boundary
+    ReaderDelimiter,    // after a boundary, before the line ending (or the -- closing the body)
+    ReaderHeaders,
+    ReaderBody,
+    ReaderEpilogue,     // after the closing boundary
+    ReaderFailed,
+  } ReaderState;
+
+  void reset();
+  void process();
+  size_t findDelimiter(const uint8_t* data, size_t length) const;
+  void parseHeader(const char* line, size_t length);
+  bool deliver(const uint8_t* data, size_t length);
+
+protected:
+  char delimiter[4 + HTTP_MULTIPART_MAX_BOUNDARY + 1];
+  size_t delimiterLength = 0;
+  uint8_t skip[256];
+
+  ReaderState state = ReaderState::ReaderFailed;
+  HTTPResponsePart part;
+  size_t parts = 0;
+  HTTPResponsePartCallback callback;
+
+  uint8_t buffer[HTTP_MULTIPART_BUFFER_SIZE];
+  size_t start = 0;
+  size_t end = 0;
+};
+
+
+
+#endif // HTTP_MULTIPART_READER_H
@@ -0,0 +1,211 @@
+#include "HTTPMultipartSource.h"
+
+
+
+HTTPMultipartSource::HTTPMultipartSource() {
+  static const char hex[] = "0123456789abcdef";
+  size_t n = strlen("TeHTTPClient");
+
+  // Random enough not to turn up in the parts' content
+  memcpy(boundaryText, "TeHTTPClient", n);
+  for (; n < sizeof(boundaryText) - 1; ++n) {
+    boundaryText[n] = hex[random(16)];
+  }
+  boundaryText[n] = '\0';
+
+  snprintf(contentTypeText, sizeof(contentTypeText), "multipart/form-data; boundary=%s", boundaryText);
+}
+
+
+
+bool HTTPMultipartSource::addField(const char* name, const char* value) {
+  return addPart(name, nullptr, nullptr, (value != nullptr) ? value : "", nullptr);
+}
+
+
+
+bool HTTPMultipartSource::addFile(const char* name, const char* filename, const char* type, HTTPBodySource& source) {
+  return addPart(name, filename, type, nullptr, &source);
+}
+
+
+
+// Names go into quoted header parameters, where a quote or line break would break the part's head
+static bool quotable(const char* text) {
+  return text == nullptr || strpbrk(text, "\"\r\n") == nullptr;
+}
+
+
+
+bool HTTPMultipartSource::addPart(const char* name, const char* filename, const char* type, const char* value, HTTPBodySource* source) {
+  if (count == HTTP_MULTIPART_MAX_PARTS) {
+    Serial.println(F("[HTTPMultipartSource] Too many parts"));
+    return false;
+  }
+
+  if (name == nullptr || !quotable(name) || !quotable(filename) || (type != nullptr && strpbrk(type, "\r\n") != nullptr)) {
+    Serial.println(F("[HTTPMultipartSource] Malformed part name"));
+    return false;
+  }
+
+  parts[count++] = { name, filename, type, value, source };
+  return true;
+}
+
+
+
+/**
+ * @brief The text in front of a part's content, split into pieces so it is streamed without being assembled.
+ * A field's value is the last piece of its head, the part after the last is the closing boundary.
+ *
+ * @return The piece, or nullptr past the last one
+ */
+const char* HTTPMultipartSource::piece(size_t part, uint8_t index) const {
+  // Every part but the first ends the content of the one before it
+  const char* delimiter = (part > 0) ? "\r\n--" : "--";
+
+  if (part == count) {
+    switch (index) {
+      case 0: return delimiter;
+      case 1: return boundaryText;
+      case 2: return "--\r\n";
+      default: return nullptr;
+    }
+  }
+
+  const HTTPMultipartPart& p = parts[part];
+
+  switch (index) {
+    case 0: return delimiter;
+    case 1: return boundaryText;
+    case 2: return "\r\nContent-Disposition: form-data; name=\"";
+    case 3: return p.name;
+    case 4: return (p.filename != nullptr) ? "\"; filename=\"" : "";
+    case 5: return (p.filename != nullptr) ? p.filename : "";
+    case 6: return "\"\r\n";
+    case 7: return (p.type != nullptr) ? "Content-Type: " : "";
+    case 8: return (p.type != nullptr) ? p.type : "";
+    case 9: return (p.type != nullptr) ? "\r\n" : "";
+    case 10: return "\r\n";
+    case 11: return (p.source == nullptr) ? p.value : nullptr;
+    default: return nullptr;
+  }
+}
+
+
+
+/**
+ * @brief The length of the form, the generated text plus every file's length.
+ *
+ * @return The length in bytes, -1 if a source does not know its length
+ */
+long int HTTPMultipartSource::length() const {
+  long int total = 0;
+  const char* text;
+
+  for (size_t i = 0; i <= count; ++i) {
+    for (uint8_t j = 0; (text = piece(i, j)) != nullptr; ++j) {
+      total += strlen(text);
+    }
+
+    if (i < count && parts[i].source != nullptr) {
+      long int n = parts[i].source->length();
+
+      if (n < 0) {
+        return -1;
+      }
+
+      total += n;
+    }
+  }
+
+  return total;
+}
+
+
+
+bool HTTPMultipartSource::rewind() {
+  for (size_t i = 0; i < count; ++i) {
+    if (parts[i].source != nullptr && !parts[i].source->rewind()) {
+      return false;
+    }
+  }
+
+  part = 0;
+  pieceIndex = 0;
+  pieceOffset = 0;
+  inBody = false;
+
+  return true;
+}
+
+
+
+/**
+ * @brief Copies the next part heads and content into buffer, reading the current file's source straight into it.
+ *
+ * @return The number of bytes copied, 0 when the current source has nothing ready yet, HTTP_SOURCE_END or HTTP_SOURCE_ERROR
+ */
+long int HTTPMultipartSource::read(uint8_t* buffer, size_t capacity) {
+  size_t n = 0;
+  size_t k;
+  long int r;
+  const char* text;
+
+  while (n < capacity && part <= count) {
+    if (inBody) {
+      r = parts[part].source->read(buffer + n, capacity - n);
+
+      if (r == HTTP_SOURCE_END) {
+        inBody = false;
+        ++part;
+        continue;
+      }
+
+      if (r < 0) {
+        return HTTP_SOURCE_ERROR;
+      }
+
+      if (r == 0) {
+        break;
+      }
+
+      n += r;
+      continue;
+    }
+
+    text = piece(part, pieceIndex);
+
+    if (text == nullptr) {
+      pieceIndex = 0;
+      pieceOffset = 0;
+
+      if (part < count && parts[part].source != nullptr) {
+        inBody = true;
+      } else {
+        ++part;
+      }
+      continue;
+    }
+
+    k = strlen(text + pieceOffset);
+    if (k > capacity - n) {
+      k = capacity - n;
+    }
+
+    memcpy(buffer + n, text + pieceOffset, k);
+    n += k;
+    pieceOffset += k;
+
+    if (text[pieceOffset] == '\0') {
+      ++pieceIndex;
+      pieceOffset = 0;
+    }
+  }
+
+  if (n == 0 && part > count) {
+    return HTTP_SOURCE_END;
+  }
+
+  return n;
+}
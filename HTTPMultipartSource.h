@@ -0,0 +1,72 @@
+#ifndef HTTP_MULTIPART_SOURCE_H
+#define HTTP_MULTIPART_SOURCE_H
+
+
+
+#include <Arduino.h>
+
+#include "HTTPBodySource.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+
+// Upper bound for the fields and files of a form
+#ifndef HTTP_MULTIPART_MAX_PARTS
+#define HTTP_MULTIPART_MAX_PARTS 8
+#endif
+
+
+
+struct HTTPMultipartPart {
+  const char* name;
+  const char* filename;         // nullptr for a field
+  const char* type;             // Content-Type of a file, nullptr to leave it out
+  const char* value;            // a field's value, when it has no source
+  HTTPBodySource* source;       // a file's content
+};
+
+
+
+// A multipart/form-data body streamed part by part, the boundaries and part headers are generated as they are read
+// and every file's content is pulled from its own source, so the form is never held in memory.
+// Sent with Content-Length when every source knows its length and chunked otherwise, the Content-Type with the boundary is sent along.
+// Names, values and sources are not copied, they must outlive the upload
+class HTTPMultipartSource : public HTTPBodySource
+{
+public:
+  HTTPMultipartSource();
+
+  // false if the form is full or the name contains a quote or line break
+  bool addField(const char* name, const char* value);
+  bool addFile(const char* name, const char* filename, const char* type, HTTPBodySource& source);
+
+  const char* boundary() const { return boundaryText; }
+
+  virtual long int read(uint8_t* buffer, size_t capacity) override;
+  virtual long int length() const override;
+  virtual bool rewind() override;
+  virtual const char* contentType() const override { return contentTypeText; }
+
+protected:
+  bool addPart(const char* name, const char* filename, const char* type, const char* value, HTTPBodySource* source);
+  const char* piece(size_t part, uint8_t index) const;
+
+protected:
+  HTTPMultipartPart parts[HTTP_MULTIPART_MAX_PARTS];
+  size_t count = 0;
+
+  char boundaryText[33];
+  char contentTypeText[64];
+
+  // Read position, the part (count for the closing boundary), the piece of its head and the offset into that piece
+  size_t part = 0;
+  uint8_t pieceIndex = 0;
+  size_t pieceOffset = 0;
+  bool inBody = false;
+};
+
+
+
+#endif // HTTP_MULTIPART_SOURCE_H
@@ -0,0 +1,113 @@
+#include "HTTPRequestTemplate.h"
+#include "HTTPClient.h"
+
+
+
+/**
+ * @brief Splits the text into literal runs and slots, once.
+ * The text is read with pgm_read_byte so it can stay in flash.
+ *
+ * @param text The request line and headers, each line CRLF terminated
+ */
+HTTPRequestTemplate::HTTPRequestTemplate(const char* text) :
+  source(text)
+{
+  size_t literalStart = 0;
+  size_t i = 0;
+  bool inLine = true;
+  bool ok = true;
+  char c;
+
+  if (text == nullptr) {
+    return;
+  }
+
+  while ((c = pgm_read_byte(text + i)) != '\0') {
+    if (i > UINT16_MAX) {
+      ok = false;
+      break;
+    }
+
+    uint8_t slot = HTTP_TEMPLATE_SLOT_NONE;
+    size_t slotLength = 0;
+
+    if (c == '{') {
+      char a = pgm_read_byte(text + i + 1);
+
+      if (a >= '0' && a <= '9' && pgm_read_byte(text + i + 2) == '}') {
+        slot = a - '0';
+        slotLength = 3;
+      } else if (a == 'l' && pgm_read_byte(text + i + 2) == 'e' && pgm_read_byte(text + i + 3) == 'n' && pgm_read_byte(text + i + 4) == '}') {
+        slot = HTTP_TEMPLATE_SLOT_LENGTH;
+        slotLength = 5;
+      }
+    }
+
+    if (slotLength > 0) {
+      if (!addSegment(literalStart, i - literalStart, HTTP_TEMPLATE_SLOT_NONE) || !addSegment(0, 0, slot)) {
+        ok = false;
+        break;
+      }
+
+      if (slot != HTTP_TEMPLATE_SLOT_LENGTH && slot + 1 > slotCount) {
+        slotCount = slot + 1;
+      }
+
+      i += slotLength;
+      literalStart = i;
+      continue;
+    }
+
+    ++i;
+
+    // The request line gets a segment boundary of its own so Host can be written right after it
+    if (inLine && c == '\n') {
+      if (!addSegment(literalStart, i - literalStart, HTTP_TEMPLATE_SLOT_NONE)) {
+        ok = false;
+        break;
+      }
+
+      literalStart = i;
+      lineSegmentCount = segmentCount;
+      inLine = false;
+    }
+  }
+
+  if (!ok || !addSegment(literalStart, i - literalStart, HTTP_TEMPLATE_SLOT_NONE) || inLine) {
+    Serial.println(F("[HTTPRequestTemplate] Invalid template, too long or no request line"));
+
+    segmentCount = 0;
+    return;
+  }
+
+  // The method out of flash, "OPTIONS " is the longest one that matters
+  char method[9];
+  size_t n = 0;
+
+  while (n + 1 < sizeof(method) && (method[n] = pgm_read_byte(text + n)) != '\0') {
+    ++n;
+  }
+  method[n] = '\0';
+
+  isIdempotent = HTTPClient::isIdempotent(method);
+}
+
+
+
+// Empty literal runs are dropped, false when the segments are used up
+bool HTTPRequestTemplate::addSegment(uint16_t offset, uint16_t length, uint8_t slot) {
+  if (slot == HTTP_TEMPLATE_SLOT_NONE && length == 0) {
+    return true;
+  }
+
+  if (segmentCount == HTTP_TEMPLATE_MAX_SEGMENTS) {
+    return false;
+  }
+
+  segments[segmentCount].offset = offset;
+  segments[segmentCount].length = length;
+  segments[segmentCount].slot = slot;
+  ++segmentCount;
+
+  return true;
+}
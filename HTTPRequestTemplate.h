@@ -0,0 +1,74 @@
+#ifndef HTTP_REQUEST_TEMPLATE_H
+#define HTTP_REQUEST_TEMPLATE_H
+
+
+
+#include <Arduino.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+
+// Upper bound for the literal runs and slots a template is split into
+#ifndef HTTP_TEMPLATE_MAX_SEGMENTS
+#define HTTP_TEMPLATE_MAX_SEGMENTS 16
+#endif
+
+// Slot index of the {len} slot, filled in with the body's Content-Length
+#define HTTP_TEMPLATE_SLOT_LENGTH 0xFE
+// Slot index of literal segments
+#define HTTP_TEMPLATE_SLOT_NONE   0xFF
+
+
+
+struct HTTPTemplateSegment {
+  uint16_t offset = 0;                      // into the template text, literal segments only
+  uint16_t length = 0;
+  uint8_t slot = HTTP_TEMPLATE_SLOT_NONE;   // 0 - 9 for a value slot
+};
+
+
+
+// A request line and header block split once into literal runs and slots, so sending it is a handful of copies.
+// "{0}" to "{9}" are replaced with the values passed when sending, "{len}" with the length of the body, any other brace is literal.
+// The text is not copied and may live in flash, it must outlive the template. Host and the blank line ending the head are added by the client.
+//
+//   HTTPRequestTemplate state(F("PUT /devices/{0}/state HTTP/1.1\r\n"
+//                               "Authorization: Bearer {1}\r\n"
+//                               "Content-Length: {len}\r\n"));
+class HTTPRequestTemplate
+{
+public:
+  HTTPRequestTemplate(const char* text);
+  HTTPRequestTemplate(const __FlashStringHelper* text) : HTTPRequestTemplate((const char*)text) {}
+
+  // false if the text had too many segments, was too long, or does not start with a request line
+  bool valid() const { return segmentCount > 0; }
+
+  const char* text() const { return source; }
+  size_t size() const { return segmentCount; }
+  const HTTPTemplateSegment& segment(size_t i) const { return segments[i]; }
+  // Segments [0, lineSegments()) make up the request line including its CRLF
+  size_t lineSegments() const { return lineSegmentCount; }
+  // Highest value slot used plus one, the number of values a send needs
+  size_t slots() const { return slotCount; }
+
+  // GET, HEAD, PUT, DELETE, OPTIONS and TRACE templates may be retried
+  bool idempotent() const { return isIdempotent; }
+
+protected:
+  bool addSegment(uint16_t offset, uint16_t length, uint8_t slot);
+
+protected:
+  const char* source;
+  HTTPTemplateSegment segments[HTTP_TEMPLATE_MAX_SEGMENTS];
+  uint8_t segmentCount = 0;
+  uint8_t lineSegmentCount = 0;
+  uint8_t slotCount = 0;
+  bool isIdempotent = false;
+};
+
+
+
+#endif // HTTP_REQUEST_TEMPLATE_H
@@ -0,0 +1,77 @@
+#include "HTTPRttEstimator.h"
+
+
+
+HTTPRttEstimator::HTTPRttEstimator(unsigned long minTimeout, unsigned long maxTimeout) :
+  minTimeout(minTimeout),
+  maxTimeout(maxTimeout)
+{
+}
+
+
+
+// FNV-1a over the hostname and port, never 0 so 0 can mark free slots
+uint32_t HTTPRttEstimator::hostKey(const char* hostname, uint16_t port) {
+  uint32_t h = 2166136261u;
+
+  for (const char* p = hostname; *p != '\0'; ++p) {
+    h = (h ^ (uint8_t)tolower((unsigned char)*p)) * 16777619u;
+  }
+
+  h = (h ^ (port & 0xFF)) * 16777619u;
+  h = (h ^ (port >> 8)) * 16777619u;
+
+  return (h != 0) ? h : 1;
+}
+
+
+
+// RFC 6298 section 2
+void HTTPRttEstimator::sample(HTTPRttSample& s, unsigned long ms) {
+  if (s.srtt == 0) {
+    s.srtt = (ms > 0) ? ms : 1;
+    s.rttvar = ms / 2;
+  } else {
+    uint32_t delta = (s.srtt > ms) ? s.srtt - ms : ms - s.srtt;
+
+    s.rttvar = (3 * s.rttvar + delta) / 4;
+    s.srtt = (7 * s.srtt + ms) / 8;
+  }
+
+  s.backoff = 0;
+}
+
+
+
+void HTTPRttEstimator::backOff(HTTPRttSample& s) {
+  if (s.backoff < 16) {
+    ++s.backoff;
+  }
+}
+
+
+
+// RTO = SRTT + 4 * RTTVAR, doubled for every timeout since the last sample and kept within the bounds
+unsigned long HTTPRttEstimator::timeout(const HTTPRttHost* host, bool connect) const {
+  if (host == nullptr) {
+    return 0;
+  }
+
+  const HTTPRttSample& s = connect ? host->connect : host->firstByte;
+
+  if (s.srtt == 0) {
+    return 0;
+  }
+
+  unsigned long rto = s.srtt + 4 * s.rttvar;
+
+  for (uint8_t i = 0; i < s.backoff && rto < maxTimeout; ++i) {
+    rto *= 2;
+  }
+
+  if (rto < minTimeout) {
+    return minTimeout;
+  }
+
+  return (rto > maxTimeout) ? maxTimeout : rto;
+}
@@ -0,0 +1,73 @@
+#ifndef HTTP_RTT_ESTIMATOR_H
+#define HTTP_RTT_ESTIMATOR_H
+
+
+
+#include <Arduino.h>
+
+#include "HTTPHostTable.h"
+
+#include <stdint.h>
+
+
+
+// Number of hosts an estimator tracks before the least recently used one is forgotten
+#ifndef HTTP_RTT_MAX_HOSTS
+#define HTTP_RTT_MAX_HOSTS 8
+#endif
+
+
+
+// Smoothed round trip time and variance of one kind of measurement, as TCP keeps them (RFC 6298)
+struct HTTPRttSample {
+  uint32_t srtt = 0;      // smoothed round trip time in ms, 0 until the first sample
+  uint32_t rttvar = 0;    // round trip time variance in ms
+  uint8_t backoff = 0;    // timeouts since the last good sample, each doubles the derived timeout
+};
+
+
+
+struct HTTPRttHost {
+  uint32_t key = 0;       // hash of the hostname and port, 0 for an unused slot
+  uint32_t lastUsed = 0;
+  HTTPRttSample connect;      // time to establish the connection
+  HTTPRttSample firstByte;    // time from sending the request to the first byte of the response
+};
+
+
+
+// Derives connect and read timeouts per host from the client's own connect and time to first byte measurements.
+// Not synchronised, share one between clients on different tasks only with your own locking.
+class HTTPRttEstimator
+{
+public:
+  HTTPRttEstimator(unsigned long minTimeout = 200, unsigned long maxTimeout = 10000);
+
+  static uint32_t hostKey(const char* hostname, uint16_t port);
+
+  void sampleConnect(uint32_t key, unsigned long ms) { sample(entry(key).connect, ms); }
+  void sampleFirstByte(uint32_t key, unsigned long ms) { sample(entry(key).firstByte, ms); }
+  void connectTimedOut(uint32_t key) { backOff(entry(key).connect); }
+  void firstByteTimedOut(uint32_t key) { backOff(entry(key).firstByte); }
+
+  // 0 when nothing is known about the host yet
+  unsigned long connectTimeout(uint32_t key) const { return timeout(find(key), true); }
+  unsigned long firstByteTimeout(uint32_t key) const { return timeout(find(key), false); }
+
+  const HTTPRttHost* find(uint32_t key) const { return hosts.find(key); }
+
+protected:
+  HTTPRttHost& entry(uint32_t key) { return hosts.entry(key); }
+  void sample(HTTPRttSample& s, unsigned long ms);
+  void backOff(HTTPRttSample& s);
+  unsigned long timeout(const HTTPRttHost* host, bool connect) const;
+
+protected:
+  HTTPHostTable<HTTPRttHost, HTTP_RTT_MAX_HOSTS> hosts;
+  unsigned long minTimeout;
+  unsigned long maxTimeout;
+};
+
+
+
+#endif // HTTP_RTT_ESTIMATOR_H
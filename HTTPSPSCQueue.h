@@ -0,0 +1,69 @@
+#ifndef HTTP_SPSC_QUEUE_H
+#define HTTP_SPSC_QUEUE_H
+
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+
+
+// Lock-free ring buffer for exactly one producer task and one consumer task.
+// Capacity must be a power of two, the queue holds upto Capacity items.
+template<typename T, size_t Capacity>
+class HTTPSPSCQueue
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "HTTPSPSCQueue capacity must be a power of two");
+
+public:
+  // Producer side, returns false when the queue is full
+  bool push(const T& item)
+  {
+    size_t tail = this->tail.load(std::memory_order_relaxed);
+
+    if (tail - head.load(std::memory_order_acquire) == Capacity)
+    {
+      return false;
+    }
+
+    items[tail & (Capacity - 1)] = item;
+    this->tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Consumer side, returns false when the queue is empty
+  bool pop(T& item)
+  {
+    size_t head = this->head.load(std::memory_order_relaxed);
+
+    if (head == tail.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+
+    item = items[head & (Capacity - 1)];
+    this->head.store(head + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  size_t size() const
+    { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+  bool empty() const
+    { return size() == 0; }
+
+  // Only safe while neither side is using the queue
+  void clear()
+    { head.store(0, std::memory_order_relaxed); tail.store(0, std::memory_order_relaxed); }
+
+private:
+  T items[Capacity];
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+};
+
+
+
+#endif // HTTP_SPSC_QUEUE_H
@@ -0,0 +1,126 @@
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+  #define HTTP_SCAN_SSE2
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(__ARM_ARCH_7A__))
+  #include <arm_neon.h>
+  #define HTTP_SCAN_NEON
+#endif
+
+
+
+// Delimiter scanning helpers used by the header and chunk framing parsers.
+// Each helper searches the half open range [begin, end) and returns end when nothing was found.
+// Host builds use SSE2/NEON, MCU builds fall back to word-at-a-time (SWAR) scanning, with a scalar tail.
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+typedef uint64_t http_scan_word_t;
+#else
+typedef uint32_t http_scan_word_t;
+#endif
+
+#define HTTP_SCAN_ONES  ((http_scan_word_t)~(http_scan_word_t)0 / 0xFF)
+#define HTTP_SCAN_HIGHS (HTTP_SCAN_ONES * 0x80)
+
+
+
+// Non zero if any byte in the word is zero
+static inline http_scan_word_t httpScanHasZero(http_scan_word_t v) {
+  return (v - HTTP_SCAN_ONES) & ~v & HTTP_SCAN_HIGHS;
+}
+
+
+
+// Finds the first occurence of c in [begin, end)
+static inline const uint8_t* httpFindByte(const uint8_t* begin, const uint8_t* end, uint8_t c) {
+  const uint8_t* p = begin;
+
+#if defined(HTTP_SCAN_SSE2)
+  const __m128i needle = _mm_set1_epi8((char)c);
+
+  for (; end - p >= 16; p += 16) {
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), needle));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#elif defined(HTTP_SCAN_NEON)
+  const uint8x16_t needle = vdupq_n_u8(c);
+
+  for (; end - p >= 16; p += 16) {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(p), needle);
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if (mask != 0) {
+      return p + (__builtin_ctzll(mask) >> 2);
+    }
+  }
+#endif
+
+  const http_scan_word_t pattern = HTTP_SCAN_ONES * c;
+  http_scan_word_t w;
+
+  for (; (size_t)(end - p) >= sizeof(w); p += sizeof(w)) {
+    memcpy(&w, p, sizeof(w));
+    if (httpScanHasZero(w ^ pattern)) {
+      break;  // the match is inside this word, let the scalar loop pin point it
+    }
+  }
+
+  for (; p < end; ++p) {
+    if (*p == c) {
+      return p;
+    }
+  }
+
+  return end;
+}
+
+
+
+// Finds the first "\r\n" in [begin, end), returns a pointer to the '\r'
+static inline const uint8_t* httpFindCRLF(const uint8_t* begin, const uint8_t* end) {
+  const uint8_t* p = begin;
+
+  while ((p = httpFindByte(p, end, '\r')) < end) {
+    if (p + 1 == end) {
+      break;  // a lone '\r' at the end of the data could still be a line ending once more arrives
+    }
+    if (p[1] == '\n') {
+      return p;
+    }
+    ++p;
+  }
+
+  return end;
+}
+
+
+
+// Finds the empty line terminating a header block, returns a pointer to the first '\r' of "\r\n\r\n"
+static inline const uint8_t* httpFindHeaderEnd(const uint8_t* begin, const uint8_t* end) {
+  const uint8_t* p = begin;
+
+  while ((p = httpFindCRLF(p, end)) < end) {
+    if (end - p < 4) {
+      break;
+    }
+    if (p[2] == '\r' && p[3] == '\n') {
+      return p;
+    }
+    p += 2;
+  }
+
+  return end;
+}
+
+
+
+#endif // HTTP_SCAN_H
@@ -0,0 +1,296 @@
+#include "HTTPTelemetryQueue.h"
+
+
+
+// Records are stored back to back, each behind its length as two little endian bytes and the millis() it was queued at as four
+static const size_t recordHeader = 6;
+
+static size_t recordLength(const uint8_t* at) {
+  return at[0] | (at[1] << 8);
+}
+
+static unsigned long recordTime(const uint8_t* at) {
+  return (uint32_t)at[2] | ((uint32_t)at[3] << 8) | ((uint32_t)at[4] << 16) | ((uint32_t)at[5] << 24);
+}
+
+static void writeHeader(uint8_t* at, size_t length, unsigned long queuedAt) {
+  at[0] = length & 0xFF;
+  at[1] = length >> 8;
+  at[2] = queuedAt & 0xFF;
+  at[3] = (queuedAt >> 8) & 0xFF;
+  at[4] = (queuedAt >> 16) & 0xFF;
+  at[5] = (queuedAt >> 24) & 0xFF;
+}
+
+static bool discardResponse(uint8_t*, size_t) {
+  return true;
+}
+
+
+
+void HTTPTelemetryBatch::set(const uint8_t* records, size_t bytes, size_t count) {
+  this->records = records;
+  this->bytes = bytes;
+
+  // The records without their headers, a comma between each and the brackets
+  total = (count == 0) ? 2 : bytes - recordHeader * count + (count - 1) + 2;
+
+  rewind();
+}
+
+
+
+bool HTTPTelemetryBatch::rewind() {
+  offset = 0;
+  remaining = 0;
+  opened = false;
+  separated = false;
+  closed = false;
+
+  return true;
+}
+
+
+
+long int HTTPTelemetryBatch::read(uint8_t* buffer, size_t capacity) {
+  size_t n = 0;
+  size_t k;
+
+  if (closed) {
+    return HTTP_SOURCE_END;
+  }
+
+  if (!opened && capacity > 0) {
+    buffer[n++] = '[';
+    opened = true;
+  }
+
+  while (n < capacity) {
+    if (remaining == 0) {
+      if (offset >= bytes) {
+        buffer[n++] = ']';
+        closed = true;
+        break;
+      }
+
+      if (offset > 0 && !separated) {
+        buffer[n++] = ',';
+        separated = true;
+        continue;
+      }
+
+      remaining = recordLength(records + offset);
+      offset += recordHeader;
+      separated = false;
+    }
+
+    k = capacity - n;
+    if (k > remaining) {
+      k = remaining;
+    }
+
+    memcpy(buffer + n, records + offset, k);
+    n += k;
+    offset += k;
+    remaining -= k;
+  }
+
+  return n;
+}
+
+
+
+HTTPTelemetryQueue::HTTPTelemetryQueue(HTTPClient& client, const char* hostname, uint16_t port, const char* path,
+    size_t maxBatchBytes, unsigned long maxAge) :
+  client(client),
+  hostname(hostname),
+  port(port),
+  request(String("POST ") + path + " HTTP/1.1"),
+  maxBatchBytes(maxBatchBytes),
+  maxAge(maxAge)
+{
+}
+
+
+
+/**
+ * @brief Queues a record, a complete JSON value such as an object.
+ * Once anything has been spilled new records are spilled too, so the order is kept.
+ *
+ * @return false if the record is empty, larger than the buffer, or there is no room for it in RAM or the spill
+ */
+bool HTTPTelemetryQueue::add(const uint8_t* record, size_t length) {
+  if (length == 0 || length > 0xFFFF || length + recordHeader > sizeof(buffer)) {
+    ++statistics.dropped;
+    return false;
+  }
+
+  if ((spill != nullptr && spill->size() > 0) || used + recordHeader + length > sizeof(buffer)) {
+    if (spill != nullptr && spill->push(record, length)) {
+      ++statistics.queued;
+      return true;
+    }
+
+    Serial.println(F("[HTTPTelemetryQueue] Queue full, dropping the record"));
+
+    ++statistics.dropped;
+    return false;
+  }
+
+  writeHeader(buffer + used, length, millis());
+  memcpy(buffer + used + recordHeader, record, length);
+  used += recordHeader + length;
+  ++count;
+  ++statistics.queued;
+
+  return true;
+}
+
+
+
+bool HTTPTelemetryQueue::poll() {
+  refill();
+
+  if (!due()) {
+    return false;
+  }
+
+  return sendBatch();
+}
+
+
+
+bool HTTPTelemetryQueue::flush() {
+  refill();
+
+  if (count == 0) {
+    return false;
+  }
+
+  return sendBatch();
+}
+
+
+
+// A batch is due once enough has been queued, the oldest record is old enough or there is a backlog, unless backing off
+bool HTTPTelemetryQueue::due() const {
+  if (count == 0) {
+    return false;
+  }
+
+  if (backoff != 0 && millis() - failedAt < backoff) {
+    return false;
+  }
+
+  // The size of the records as a JSON array, the record in front is the oldest
+  size_t json = used - (recordHeader - 1) * count + 1;
+
+  return json >= maxBatchBytes || used >= sizeof(buffer) * 3 / 4 || millis() - recordTime(buffer) >= maxAge
+    || (spill != nullptr && spill->size() > 0);
+}
+
+
+
+/**
+ * @brief Posts the oldest records, as many as fit into maxBatchBytes (at least one), as a JSON array.
+ * Delivered records are removed. Records the server rejects with a 4xx status other than 408 and 429 are dropped, they would never be accepted.
+ * Otherwise the records are kept and the next attempt backs off, doubling from the minimum upto the maximum retry delay.
+ *
+ * @return true if the batch was delivered
+ */
+bool HTTPTelemetryQueue::sendBatch() {
+  size_t offset = 0;
+  size_t records = 0;
+  size_t json = 1;
+  size_t length;
+
+  while (offset < used) {
+    length = recordLength(buffer + offset);
+
+    if (records > 0 && json + length + 1 > maxBatchBytes) {
+      break;
+    }
+
+    json += length + 1;
+    offset += recordHeader + length;
+    ++records;
+  }
+
+  batch.set(buffer, offset, records);
+
+  std::shared_ptr<ConnectionInformation> result = client.http_upload(hostname, port, request.c_str(), "Content-Type: application/json", batch, nullptr);
+  uint16_t status = (result != nullptr) ? result->return_status : 0;
+
+  // Read the response to its end so the connection can carry the next batch
+  if (result != nullptr) {
+    uint8_t scratch[64];
+    client.readBody(scratch, sizeof(scratch), discardResponse);
+  }
+
+  if (status >= 200 && status < 300) {
+    removeFront(records, offset);
+
+    statistics.sent += records;
+    ++statistics.batches;
+    backoff = 0;
+
+    refill();
+    return true;
+  }
+
+  if (status >= 400 && status < 500 && status != 408 && status != 429) {
+    Serial.printf(F("[HTTPTelemetryQueue] Server rejected the batch with %hu, dropping %u records\n"), status, (unsigned)records);
+
+    removeFront(records, offset);
+
+    statistics.dropped += records;
+    backoff = 0;
+    return false;
+  }
+
+  ++statistics.failures;
+  failedAt = millis();
+  backoff = (backoff == 0) ? minDelay : backoff * 2;
+
+  if (backoff > maxDelay) {
+    backoff = maxDelay;
+  }
+
+  Serial.printf(F("[HTTPTelemetryQueue] Sending failed, keeping %u records and retrying in %lu ms\n"), (unsigned)pending(), backoff);
+
+  return false;
+}
+
+
+
+void HTTPTelemetryQueue::removeFront(size_t records, size_t length) {
+  memmove(buffer, buffer + length, used - length);
+  used -= length;
+  count -= records;
+}
+
+
+
+// Moves spilled records back into RAM as far as they fit, oldest first
+void HTTPTelemetryQueue::refill() {
+  long int r;
+
+  if (spill == nullptr) {
+    return;
+  }
+
+  // The spill does not keep when a record was queued, a refilled record counts as queued now
+  while (spill->size() > 0 && used + recordHeader < sizeof(buffer)) {
+    r = spill->peek(buffer + used + recordHeader, sizeof(buffer) - used - recordHeader);
+
+    if (r <= 0) {
+      break;
+    }
+
+    writeHeader(buffer + used, r, millis());
+    used += recordHeader + r;
+    ++count;
+
+    spill->pop();
+  }
+}
@@ -0,0 +1,131 @@
+#ifndef HTTP_TELEMETRY_QUEUE_H
+#define HTTP_TELEMETRY_QUEUE_H
+
+
+
+#include <Arduino.h>
+
+#include "HTTPClient.h"
+#include "HTTPBodySource.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+
+// RAM a HTTPTelemetryQueue buffers records in, each record takes its length plus six bytes
+#ifndef HTTP_TELEMETRY_BUFFER_SIZE
+#define HTTP_TELEMETRY_BUFFER_SIZE 2048
+#endif
+
+
+
+// Persistent overflow for a HTTPTelemetryQueue, e.g. a file on LittleFS. Records must come back out in the order they went in
+class HTTPTelemetrySpill
+{
+public:
+  virtual ~HTTPTelemetrySpill() {}
+
+  // Appends a record, false if there is no room
+  virtual bool push(const uint8_t* record, size_t length) = 0;
+  // Copies the oldest record into buffer, returns its length or -1 if there is none or it does not fit
+  virtual long int peek(uint8_t* buffer, size_t capacity) = 0;
+  // Drops the oldest record
+  virtual void pop() = 0;
+  virtual size_t size() const = 0;
+};
+
+
+
+struct HTTPTelemetryStats {
+  uint32_t queued = 0;      // records accepted
+  uint32_t sent = 0;        // records delivered
+  uint32_t batches = 0;     // batches delivered
+  uint32_t failures = 0;    // batches that failed and were kept
+  uint32_t dropped = 0;     // records refused when full, or rejected by the server
+};
+
+
+
+// Streams a batch of queued records as a JSON array, straight out of the queue's buffer
+class HTTPTelemetryBatch : public HTTPBodySource
+{
+public:
+  void set(const uint8_t* records, size_t bytes, size_t count);
+
+  virtual long int read(uint8_t* buffer, size_t capacity) override;
+  virtual long int length() const override { return total; }
+  virtual bool rewind() override;
+
+protected:
+  const uint8_t* records = nullptr;
+  size_t bytes = 0;
+  long int total = 0;
+  size_t offset = 0;        // into records, at a length prefix when remaining is 0
+  size_t remaining = 0;     // bytes left of the record being sent
+  bool opened = false;
+  bool separated = false;   // the comma in front of the next record has been sent
+  bool closed = false;
+};
+
+
+
+// Collects small JSON records and posts them as one JSON array once enough have been queued (maxBatchBytes) or the oldest
+// is old enough (maxAge ms), amortizing the connection and header overhead over many records.
+// When sending fails the records are kept and the send is retried with a backoff, a backlog goes out in batches of at most maxBatchBytes.
+// When the RAM buffer is full records go to the spill if there is one, and are refused otherwise.
+// Not synchronised, add and poll from the same task.
+class HTTPTelemetryQueue
+{
+public:
+  HTTPTelemetryQueue(HTTPClient& client, const char* hostname, uint16_t port, const char* path,
+    size_t maxBatchBytes = 1024, unsigned long maxAge = 10000);
+
+  // The spill is not owned by the queue, nullptr turns it off
+  void setSpill(HTTPTelemetrySpill* spill) { this->spill = spill; }
+  void setRetryDelay(unsigned long minDelay, unsigned long maxDelay) { this->minDelay = minDelay; this->maxDelay = maxDelay; }
+
+  // false if the record was refused, it is copied so it need not outlive the call
+  bool add(const char* record) { return add((const uint8_t*)record, strlen(record)); }
+  bool add(const uint8_t* record, size_t length);
+
+  // Call from the loop, sends a batch when one is due. Returns true if a batch was delivered
+  bool poll();
+  // Sends a batch now, whatever the thresholds
+  bool flush();
+
+  // Records waiting, in RAM and spilled
+  size_t pending() const { return count + ((spill != nullptr) ? spill->size() : 0); }
+  const HTTPTelemetryStats& stats() const { return statistics; }
+
+protected:
+  bool due() const;
+  bool sendBatch();
+  void removeFront(size_t records, size_t length);
+  void refill();
+
+protected:
+  HTTPClient& client;
+  const char* hostname;
+  uint16_t port;
+  String request;
+  size_t maxBatchBytes;
+  unsigned long maxAge;
+  HTTPTelemetrySpill* spill = nullptr;
+
+  uint8_t buffer[HTTP_TELEMETRY_BUFFER_SIZE];
+  size_t used = 0;
+  size_t count = 0;
+
+  HTTPTelemetryBatch batch;
+  unsigned long minDelay = 1000;
+  unsigned long maxDelay = 60000;
+  unsigned long failedAt = 0;
+  unsigned long backoff = 0;      // 0 while the last batch went through
+
+  HTTPTelemetryStats statistics;
+};
+
+
+
+#endif // HTTP_TELEMETRY_QUEUE_H
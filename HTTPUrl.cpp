@@ -0,0 +1,224 @@
+#include "HTTPUrl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include "HTTPScan.h"
+
+
+
+bool HTTPStringView::copyTo(char* out, size_t capacity) const {
+  if (length + 1 > capacity) {
+    return false;
+  }
+
+  memcpy(out, data, length);
+  out[length] = '\0';
+
+  return true;
+}
+
+
+
+/**
+ * @brief Parses scheme://[userinfo@]host[:port][/path][?query][#fragment]
+ * Only the http and https schemes are accepted, userinfo is skipped.
+ *
+ * @return false if the URL is malformed or not http(s)
+ */
+bool HTTPUrl::parse(const char* url) {
+  const uint8_t* begin = (const uint8_t*)url;
+  const uint8_t* end = begin + strlen(url);
+  const uint8_t* p;
+
+  *this = HTTPUrl();
+
+  // scheme
+  p = httpFindByte(begin, end, ':');
+  if (p == end || end - p < 3 || p[1] != '/' || p[2] != '/') {
+    return false;
+  }
+
+  scheme.data = url;
+  scheme.length = p - begin;
+
+  if (scheme.length == 4 && strncasecmp(url, "http", 4) == 0) {
+    port = 80;
+  } else if (scheme.length == 5 && strncasecmp(url, "https", 5) == 0) {
+    port = 443;
+  } else {
+    return false;
+  }
+
+  // authority ends at the first '/', '?' or '#'
+  const uint8_t* authority = p + 3;
+  const uint8_t* authorityEnd = authority;
+  while (authorityEnd < end && *authorityEnd != '/' && *authorityEnd != '?' && *authorityEnd != '#') {
+    ++authorityEnd;
+  }
+
+  const uint8_t* at = httpFindByte(authority, authorityEnd, '@');
+  if (at < authorityEnd) {
+    authority = at + 1;
+  }
+
+  const uint8_t* hostEnd;
+  const uint8_t* portStart = nullptr;
+
+  if (authority < authorityEnd && *authority == '[') {
+    hostEnd = httpFindByte(authority, authorityEnd, ']');
+    if (hostEnd == authorityEnd) {
+      return false;
+    }
+
+    host.data = (const char*)authority + 1;
+    host.length = hostEnd - authority - 1;
+
+    if (hostEnd + 1 < authorityEnd) {
+      if (hostEnd[1] != ':') {
+        return false;
+      }
+      portStart = hostEnd + 2;
+    }
+  } else {
+    hostEnd = httpFindByte(authority, authorityEnd, ':');
+    host.data = (const char*)authority;
+    host.length = hostEnd - authority;
+
+    if (hostEnd < authorityEnd) {
+      portStart = hostEnd + 1;
+    }
+  }
+
+  if (host.empty()) {
+    return false;
+  }
+
+  if (portStart != nullptr) {
+    unsigned long value = 0;
+
+    for (p = portStart; p < authorityEnd; ++p) {
+      if (*p < '0' || *p > '9') {
+        return false;
+      }
+      value = value * 10 + (*p - '0');
+      if (value > 65535) {
+        return false;
+      }
+    }
+
+    if (portStart == authorityEnd || value == 0) {
+      return false;
+    }
+    port = value;
+  }
+
+  // path, query and fragment
+  const uint8_t* fragmentStart = httpFindByte(authorityEnd, end, '#');
+  const uint8_t* queryStart = httpFindByte(authorityEnd, fragmentStart, '?');
+
+  path.data = (const char*)authorityEnd;
+  path.length = queryStart - authorityEnd;
+
+  if (queryStart < fragmentStart) {
+    query.data = (const char*)queryStart + 1;
+    query.length = fragmentStart - queryStart - 1;
+  }
+
+  if (fragmentStart < end) {
+    fragment.data = (const char*)fragmentStart + 1;
+    fragment.length = end - fragmentStart - 1;
+  }
+
+  return true;
+}
+
+
+
+bool HTTPQuery::add(const char* key, const char* value) {
+  if (count == HTTP_QUERY_MAX_PARAMS || key == nullptr) {
+    return false;
+  }
+
+  params[count].key = key;
+  params[count].value = (value != nullptr) ? value : "";
+  ++count;
+
+  return true;
+}
+
+
+
+bool HTTPQuery::add(const char* key, long value) {
+  if (count == HTTP_QUERY_MAX_PARAMS || key == nullptr) {
+    return false;
+  }
+
+  snprintf(params[count].number, sizeof(params[count].number), "%ld", value);
+  params[count].key = key;
+  params[count].value = nullptr;
+  ++count;
+
+  return true;
+}
+
+
+
+bool HTTPQuery::appendTo(char* out, size_t capacity, size_t& length) const {
+  size_t n = length;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0) {
+      if (n + 1 >= capacity) {
+        return false;
+      }
+      out[n++] = '&';
+    }
+
+    if (!appendEncoded(out, capacity, n, params[i].key) || n + 1 >= capacity) {
+      return false;
+    }
+    out[n++] = '=';
+
+    if (!appendEncoded(out, capacity, n, (params[i].value != nullptr) ? params[i].value : params[i].number)) {
+      return false;
+    }
+  }
+
+  length = n;
+  out[length] = '\0';
+
+  return true;
+}
+
+
+
+// Percent-encodes everything but the RFC 3986 unreserved characters
+bool HTTPQuery::appendEncoded(char* out, size_t capacity, size_t& length, const char* text) {
+  static const char hex[] = "0123456789ABCDEF";
+  size_t n = length;
+  uint8_t c;
+
+  for (const char* p = text; *p != '\0'; ++p) {
+    c = *p;
+
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~') {
+      if (n + 1 >= capacity) {
+        return false;
+      }
+      out[n++] = c;
+    } else {
+      if (n + 3 >= capacity) {
+        return false;
+      }
+      out[n++] = '%';
+      out[n++] = hex[c >> 4];
+      out[n++] = hex[c & 0x0F];
+    }
+  }
+
+  length = n;
+  out[length] = '\0';
+
+  return true;
+}
@@ -0,0 +1,79 @@
+#ifndef HTTP_URL_H
+#define HTTP_URL_H
+
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+
+// Upper bound for the number of parameters a HTTPQuery can hold
+#ifndef HTTP_QUERY_MAX_PARAMS
+#define HTTP_QUERY_MAX_PARAMS 8
+#endif
+
+
+
+// A non owning, not null terminated, view into a string
+struct HTTPStringView {
+  const char* data = nullptr;
+  size_t length = 0;
+
+  bool empty() const { return length == 0; }
+  bool equals(const char* literal) const { return strlen(literal) == length && strncmp(data, literal, length) == 0; }
+
+  // Copies the view into a null terminated buffer, false if it does not fit
+  bool copyTo(char* out, size_t capacity) const;
+};
+
+
+
+// Splits a http:// or https:// URL in place, every part is a view into the string that was parsed.
+// The string must outlive the HTTPUrl.
+class HTTPUrl
+{
+public:
+  bool parse(const char* url);
+
+  HTTPStringView scheme;
+  HTTPStringView host;      // without the brackets of an IPv6 literal
+  HTTPStringView path;      // empty when the URL has none, send "/"
+  HTTPStringView query;     // without the leading '?'
+  HTTPStringView fragment;  // without the leading '#'
+  uint16_t port = 0;        // the scheme's default port when the URL has none
+};
+
+
+
+// Query parameters added by reference and percent-encoded only when the request line is written.
+// Keys and string values must stay valid until the request has been sent.
+class HTTPQuery
+{
+public:
+  bool add(const char* key, const char* value);
+  bool add(const char* key, long value);
+
+  size_t size() const { return count; }
+  void clear() { count = 0; }
+
+  // Appends "key=value&key=value..." percent-encoded to out at length, false (and length unchanged) if it does not fit
+  bool appendTo(char* out, size_t capacity, size_t& length) const;
+
+  static bool appendEncoded(char* out, size_t capacity, size_t& length, const char* text);
+
+protected:
+  struct Param {
+    const char* key;
+    const char* value;  // nullptr for values added as numbers, those live in number so a copied query carries its own
+    char number[12];
+  };
+
+  Param params[HTTP_QUERY_MAX_PARAMS];
+  size_t count = 0;
+};
+
+
+
+#endif // HTTP_URL_H
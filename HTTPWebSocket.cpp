@@ -0,0 +1,646 @@
+#include "HTTPWebSocket.h"
+
+#if defined(ESP32)
+#include <esp_random.h>
+#elif defined(__linux__)
+#include <sys/random.h>
+#include <errno.h>
+#endif
+
+
+
+// Appended to the key before hashing, RFC 6455 section 1.3
+static const char acceptGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// Keys and masks must be unpredictable (RFC 6455 section 5.3), they come from the platform's hardware or kernel generator.
+// returns false when the generator failed, nothing may be sent then
+static bool secureRandom(uint8_t* out, size_t length) {
+#if defined(ESP32)
+  esp_fill_random(out, length);
+#elif defined(ESP8266)
+  ESP.random(out, length);
+#elif defined(__linux__)
+  while (length > 0) {
+    ssize_t r = getrandom(out, length, 0);
+
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return false;
+    }
+
+    out += r;
+    length -= r;
+  }
+#elif defined(HTTP_WEBSOCKET_INSECURE_RANDOM)
+  for (size_t i = 0; i < length; ++i) {
+    out[i] = random(256);
+  }
+#else
+#error "HTTPWebSocket: no hardware random number generator known for this platform, define HTTP_WEBSOCKET_INSECURE_RANDOM to accept random()"
+#endif
+
+  return true;
+}
+
+
+
+static inline uint32_t rotateLeft(uint32_t value, uint8_t bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+// One 64 byte block of SHA-1, the message schedule is kept as a rolling window of 16 words
+static void sha1Block(uint32_t state[5], const uint8_t* block) {
+  uint32_t w[16];
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+  uint32_t f, k, t;
+
+  for (uint8_t i = 0; i < 16; ++i) {
+    w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 | (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+  }
+
+  for (uint8_t i = 0; i < 80; ++i) {
+    if (i >= 16) {
+      w[i & 15] = rotateLeft(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+    }
+
+    if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+    else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+    else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+    else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+    t = rotateLeft(a, 5) + f + e + k + w[i & 15];
+    e = d;
+    d = c;
+    c = rotateLeft(b, 30);
+    b = a;
+    a = t;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+static void sha1(const uint8_t* data, size_t length, uint8_t digest[20]) {
+  uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+  uint8_t block[64];
+  uint64_t bits = (uint64_t)length * 8;
+  size_t i = 0;
+
+  for (; i + 64 <= length; i += 64) {
+    sha1Block(state, data + i);
+  }
+
+  // The rest, a 1 bit, zeros and the length in bits, spilling into another block when the length does not fit
+  size_t rest = length - i;
+  memcpy(block, data + i, rest);
+  block[rest++] = 0x80;
+
+  if (rest > 56) {
+    memset(block + rest, 0, 64 - rest);
+    sha1Block(state, block);
+    rest = 0;
+  }
+
+  memset(block + rest, 0, 56 - rest);
+  for (uint8_t j = 0; j < 8; ++j) {
+    block[56 + j] = bits >> (56 - 8 * j);
+  }
+  sha1Block(state, block);
+
+  for (uint8_t j = 0; j < 20; ++j) {
+    digest[j] = state[j / 4] >> (24 - 8 * (j % 4));
+  }
+}
+
+// Encodes into out, which needs room for 4 characters per 3 bytes and the terminator
+static void base64Encode(const uint8_t* data, size_t length, char* out) {
+  static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  uint32_t v;
+
+  for (size_t i = 0; i < length; i += 3) {
+    v = (uint32_t)data[i] << 16 | ((i + 1 < length) ? data[i + 1] << 8 : 0) | ((i + 2 < length) ? data[i + 2] : 0);
+
+    *out++ = table[(v >> 18) & 63];
+    *out++ = table[(v >> 12) & 63];
+    *out++ = (i + 1 < length) ? table[(v >> 6) & 63] : '=';
+    *out++ = (i + 2 < length) ? table[v & 63] : '=';
+  }
+
+  *out = '\0';
+}
+
+
+
+/**
+ * @brief Sends the upgrade request with a random Sec-WebSocket-Key and checks the server switched protocols.
+ * The server must answer 101 with Upgrade: websocket and the Sec-WebSocket-Accept matching the key, and may not enable an extension.
+ *
+ * @return false if the handshake failed, the connection is closed then
+ */
+bool HTTPWebSocket::connect(const char* hostname, uint16_t port, const char* path, const char* protocols, const char* inHeaders) {
+  uint8_t nonce[16];
+  uint8_t digest[20];
+  char key[25];
+  char expected[29];
+  std::vector<String> headers;
+  bool upgraded = false;
+  bool connectionUpgrade = false;
+  bool accepted = false;
+  bool extended = false;
+
+  if (currentState != HTTPWebSocketState::WebSocketClosed) {
+    Serial.println(F("[HTTPWebSocket] Already connected"));
+    return false;
+  }
+
+  if (!secureRandom(nonce, sizeof(nonce))) {
+    Serial.println(F("[HTTPWebSocket] No random numbers for the key"));
+    return false;
+  }
+
+  base64Encode(nonce, sizeof(nonce), key);
+
+  String request = "Upgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: ";
+  request += key;
+  request += "\r\n";
+
+  if (protocols != nullptr) {
+    request += "Sec-WebSocket-Protocol: ";
+    request += protocols;
+    request += "\r\n";
+  }
+
+  if (inHeaders != nullptr) {
+    request += inHeaders;
+  }
+
+  std::shared_ptr<ConnectionInformation> result = client.http_get(hostname, port, String(path), request.c_str(), &headers);
+
+  if (result == nullptr || result->return_status != 101) {
+    Serial.printf(F("[HTTPWebSocket] Upgrade refused, status %hu\n"), (result != nullptr) ? result->return_status : 0);
+
+    client.stop();
+    return false;
+  }
+
+  String accept = key;
+  accept += acceptGuid;
+  sha1((const uint8_t*)accept.c_str(), accept.length(), digest);
+  base64Encode(digest, sizeof(digest), expected);
+
+  selectedProtocol[0] = '\0';
+
+  for (const String& header : headers) {
+    int colon = header.indexOf(':');
+
+    if (colon < 0) {
+      continue;
+    }
+
+    String name = header.substring(0, colon);
+    String value = header.substring(colon + 1);
+    value.trim();
+
+    if (name.equalsIgnoreCase("upgrade")) {
+      upgraded = value.equalsIgnoreCase("websocket");
+    } else if (name.equalsIgnoreCase("connection")) {
+      // A token list, e.g. "keep-alive, Upgrade"
+      int start = 0;
+
+      while (start <= (int)value.length()) {
+        int comma = value.indexOf(',', start);
+        String token = value.substring(start, comma < 0 ? value.length() : comma);
+
+        token.trim();
+        if (token.equalsIgnoreCase("upgrade")) {
+          connectionUpgrade = true;
+        }
+
+        if (comma < 0) {
+          break;
+        }
+        start = comma + 1;
+      }
+    } else if (name.equalsIgnoreCase("sec-websocket-accept")) {
+      accepted = value == expected;
+    } else if (name.equalsIgnoreCase("sec-websocket-extensions")) {
+      extended = true;
+    } else if (name.equalsIgnoreCase("sec-websocket-protocol")) {
+      strncpy(selectedProtocol, value.c_str(), sizeof(selectedProtocol) - 1);
+      selectedProtocol[sizeof(selectedProtocol) - 1] = '\0';
+    }
+  }
+
+  if (!upgraded || !connectionUpgrade || !accepted || extended) {
+    Serial.println(F("[HTTPWebSocket] Invalid handshake response"));
+
+    client.stop();
+    return false;
+  }
+
+  Serial.printf(F("[HTTPWebSocket] Connected to %s:%hu%s\n"), hostname, port, path);
+
+  currentState = HTTPWebSocketState::WebSocketOpen;
+  receivedCloseCode = 1006;
+  activityAt = millis();
+
+  return true;
+}
+
+
+
+/**
+ * @brief Parses the frames that have arrived, answering pings and closes, and keeps an idle connection alive with pings.
+ *
+ * @return true until the connection is closed, keep polling while closing to finish the close handshake
+ */
+bool HTTPWebSocket::poll() {
+  uint8_t buffer[HTTP_WEBSOCKET_BLOCK_SIZE];
+  long int r = 0;
+  unsigned long now;
+
+  if (currentState == HTTPWebSocketState::WebSocketClosed) {
+    return false;
+  }
+
+  while (currentState != HTTPWebSocketState::WebSocketClosed && (r = client.readAvailable(buffer, sizeof(buffer))) > 0) {
+    activityAt = millis();
+    awaitingPong = false;
+
+    consume(buffer, r);
+  }
+
+  if (currentState == HTTPWebSocketState::WebSocketClosed) {
+    return false;
+  }
+
+  if (r < 0) {
+    Serial.println(F("[HTTPWebSocket] Connection dropped"));
+
+    shutdown();
+    return false;
+  }
+
+  now = millis();
+
+  if (currentState == HTTPWebSocketState::WebSocketClosing && now - closingAt >= closeTimeout) {
+    Serial.println(F("[HTTPWebSocket] Server did not answer the close, closing anyway"));
+
+    shutdown();
+    return false;
+  }
+
+  if (currentState == HTTPWebSocketState::WebSocketOpen && pingInterval != 0) {
+    if (awaitingPong && now - pingSentAt >= pingInterval) {
+      Serial.println(F("[HTTPWebSocket] No pong, connection lost"));
+
+      shutdown();
+      return false;
+    }
+
+    if (!awaitingPong && now - activityAt >= pingInterval && ping()) {
+      awaitingPong = true;
+      pingSentAt = now;
+    }
+  }
+
+  return true;
+}
+
+
+
+bool HTTPWebSocket::sendMessage(HTTPWebSocketOpcode opcode, const uint8_t* data, size_t length, bool final) {
+  if (currentState != HTTPWebSocketState::WebSocketOpen) {
+    return false;
+  }
+
+  if (sendingFragments) {
+    Serial.println(F("[HTTPWebSocket] Finish the fragmented message first"));
+    return false;
+  }
+
+  sendingFragments = !final;
+
+  return writeFrame(opcode, data, length, final);
+}
+
+
+
+bool HTTPWebSocket::sendContinuation(const uint8_t* data, size_t length, bool final) {
+  if (currentState != HTTPWebSocketState::WebSocketOpen || !sendingFragments) {
+    return false;
+  }
+
+  sendingFragments = !final;
+
+  return writeFrame(HTTPWebSocketOpcode::WebSocketContinuation, data, length, final);
+}
+
+
+
+bool HTTPWebSocket::ping(const uint8_t* data, size_t length) {
+  if (currentState != HTTPWebSocketState::WebSocketOpen || length > sizeof(control)) {
+    return false;
+  }
+
+  return writeFrame(HTTPWebSocketOpcode::WebSocketPing, data, length, true);
+}
+
+
+
+bool HTTPWebSocket::close(uint16_t code, const char* reason) {
+  uint8_t payload[sizeof(control)];
+  size_t length = 2;
+
+  if (currentState != HTTPWebSocketState::WebSocketOpen) {
+    return false;
+  }
+
+  payload[0] = code >> 8;
+  payload[1] = code & 0xFF;
+
+  if (reason != nullptr) {
+    size_t n = strlen(reason);
+
+    if (n > sizeof(payload) - 2) {
+      n = sizeof(payload) - 2;
+    }
+
+    memcpy(payload + 2, reason, n);
+    length += n;
+  }
+
+  if (!writeFrame(HTTPWebSocketOpcode::WebSocketClose, payload, length, true)) {
+    return false;
+  }
+
+  currentState = HTTPWebSocketState::WebSocketClosing;
+  closingAt = millis();
+
+  return true;
+}
+
+
+
+/**
+ * @brief Writes a frame, masking the payload block by block into a stack buffer the header goes out in front of.
+ * Client frames must be masked with a fresh key every time, RFC 6455 section 5.3.
+ *
+ * @return false if the connection would not take it, it is closed then
+ */
+bool HTTPWebSocket::writeFrame(uint8_t opcode, const uint8_t* data, size_t length, bool final) {
+  uint8_t block[HTTP_WEBSOCKET_BLOCK_SIZE];
+  uint8_t mask[4];
+  size_t n = 0;
+  size_t k;
+
+  block[n++] = (final ? 0x80 : 0x00) | opcode;
+
+  if (length < 126) {
+    block[n++] = 0x80 | length;
+  } else if (length <= 0xFFFF) {
+    block[n++] = 0x80 | 126;
+    block[n++] = length >> 8;
+    block[n++] = length & 0xFF;
+  } else {
+    block[n++] = 0x80 | 127;
+    for (uint8_t i = 0; i < 8; ++i) {
+      block[n++] = (uint64_t)length >> (56 - 8 * i);
+    }
+  }
+
+  if (!secureRandom(mask, sizeof(mask))) {
+    Serial.println(F("[HTTPWebSocket] No random numbers for the mask"));
+
+    shutdown();
+    return false;
+  }
+
+  memcpy(block + n, mask, sizeof(mask));
+  n += sizeof(mask);
+
+  // Blocks are gathered in the client's transmit buffer, a small frame goes out in one write and a large one in buffer sized writes
+  for (size_t i = 0; i < length || n > 0; i += k) {
+    k = sizeof(block) - n;
+    if (k > length - i) {
+      k = length - i;
+    }
+
+    for (size_t j = 0; j < k; ++j) {
+      block[n + j] = data[i + j] ^ mask[(i + j) & 3];
+    }
+
+    n += k;
+
+    if (!client.txAppend(block, n)) {
+      break;
+    }
+
+    n = 0;
+  }
+
+  if (n != 0 || !client.txFlush()) {
+    Serial.println(F("[HTTPWebSocket] Failed to write a frame"));
+
+    shutdown();
+    return false;
+  }
+
+  return true;
+}
+
+
+
+// Splits what arrived into frame headers and payloads, handing data payloads straight to the callback
+void HTTPWebSocket::consume(const uint8_t* data, size_t length) {
+  size_t n;
+
+  while (length > 0 && currentState != HTTPWebSocketState::WebSocketClosed) {
+    if (!inPayload) {
+      header[headerLength++] = *data++;
+      --length;
+
+      if (headerLength < 2) {
+        continue;
+      }
+
+      uint8_t size = header[1] & 0x7F;
+      n = 2 + ((size == 126) ? 2 : (size == 127) ? 8 : 0) + ((header[1] & 0x80) ? 4 : 0);
+
+      if (headerLength == n && beginFrame() && payloadLeft == 0) {
+        endFrame(true);
+      }
+      continue;
+    }
+
+    n = (payloadLeft < length) ? payloadLeft : length;
+
+    if (frameOpcode >= HTTPWebSocketOpcode::WebSocketClose) {
+      memcpy(control + controlLength, data, n);
+      controlLength += n;
+    } else if (callback) {
+      callback((HTTPWebSocketOpcode)messageOpcode, data, n, frameFinal && n == payloadLeft);
+    }
+
+    data += n;
+    length -= n;
+    payloadLeft -= n;
+
+    if (payloadLeft == 0) {
+      endFrame(false);
+    }
+  }
+}
+
+
+
+/**
+ * @brief Checks a complete frame header against what the protocol allows without extensions.
+ *
+ * @return false if the frame is invalid, the connection is failed then
+ */
+bool HTTPWebSocket::beginFrame() {
+  uint8_t size = header[1] & 0x7F;
+
+  frameFinal = header[0] & 0x80;
+  frameOpcode = header[0] & 0x0F;
+  headerLength = 0;
+
+  if (size == 126) {
+    payloadLeft = (uint16_t)header[2] << 8 | header[3];
+  } else if (size == 127) {
+    payloadLeft = 0;
+    for (uint8_t i = 0; i < 8; ++i) {
+      payloadLeft = payloadLeft << 8 | header[2 + i];
+    }
+  } else {
+    payloadLeft = size;
+  }
+
+  // Reserved bits are only for extensions, server frames are never masked
+  if ((header[0] & 0x70) != 0 || (header[1] & 0x80) != 0) {
+    Serial.println(F("[HTTPWebSocket] Invalid frame"));
+
+    fail(1002);
+    return false;
+  }
+
+  switch (frameOpcode) {
+    case HTTPWebSocketOpcode::WebSocketContinuation:
+      if (messageOpcode == 0) {
+        break;
+      }
+      inPayload = true;
+      return true;
+
+    case HTTPWebSocketOpcode::WebSocketText:
+    case HTTPWebSocketOpcode::WebSocketBinary:
+      if (messageOpcode != 0) {
+        break;
+      }
+      messageOpcode = frameOpcode;
+      inPayload = true;
+      return true;
+
+    case HTTPWebSocketOpcode::WebSocketClose:
+    case HTTPWebSocketOpcode::WebSocketPing:
+    case HTTPWebSocketOpcode::WebSocketPong:
+      // Control frames may come between the fragments of a message but are never fragmented themselves
+      if (!frameFinal || payloadLeft > sizeof(control)) {
+        break;
+      }
+      controlLength = 0;
+      inPayload = true;
+      return true;
+
+    default:
+      break;
+  }
+
+  Serial.printf(F("[HTTPWebSocket] Unexpected frame, opcode %u\n"), (unsigned)frameOpcode);
+
+  fail(1002);
+  return false;
+}
+
+
+
+// Acts on a frame once its payload is complete, empty when it had none
+void HTTPWebSocket::endFrame(bool empty) {
+  uint16_t code;
+
+  inPayload = false;
+
+  switch (frameOpcode) {
+    case HTTPWebSocketOpcode::WebSocketContinuation:
+    case HTTPWebSocketOpcode::WebSocketText:
+    case HTTPWebSocketOpcode::WebSocketBinary:
+      if (frameFinal) {
+        // An empty last frame still ends the message, otherwise the callback was told with the end of the payload
+        if (empty && callback) {
+          callback((HTTPWebSocketOpcode)messageOpcode, nullptr, 0, true);
+        }
+        messageOpcode = 0;
+      }
+      break;
+
+    case HTTPWebSocketOpcode::WebSocketPing:
+      if (currentState == HTTPWebSocketState::WebSocketOpen) {
+        writeFrame(HTTPWebSocketOpcode::WebSocketPong, control, controlLength, true);
+      }
+      break;
+
+    case HTTPWebSocketOpcode::WebSocketPong:
+      awaitingPong = false;
+      break;
+
+    case HTTPWebSocketOpcode::WebSocketClose:
+      code = (controlLength >= 2) ? ((uint16_t)control[0] << 8 | control[1]) : 1005;
+      receivedCloseCode = code;
+
+      Serial.printf(F("[HTTPWebSocket] Server closed the connection, code %hu\n"), code);
+
+      // Answer with the server's code, unless this is the answer to our own close
+      if (currentState == HTTPWebSocketState::WebSocketOpen) {
+        writeFrame(HTTPWebSocketOpcode::WebSocketClose, control, (controlLength >= 2) ? 2 : 0, true);
+      }
+
+      shutdown();
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+
+// Closes the connection after telling the server why, used when it broke the protocol
+void HTTPWebSocket::fail(uint16_t code) {
+  uint8_t payload[2] = { (uint8_t)(code >> 8), (uint8_t)(code & 0xFF) };
+
+  if (currentState == HTTPWebSocketState::WebSocketOpen) {
+    writeFrame(HTTPWebSocketOpcode::WebSocketClose, payload, sizeof(payload), true);
+  }
+
+  shutdown();
+}
+
+
+
+void HTTPWebSocket::shutdown() {
+  client.stop();
+
+  currentState = HTTPWebSocketState::WebSocketClosed;
+  headerLength = 0;
+  inPayload = false;
+  messageOpcode = 0;
+  sendingFragments = false;
+  awaitingPong = false;
+}
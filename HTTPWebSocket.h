@@ -0,0 +1,124 @@
+#ifndef HTTP_WEBSOCKET_H
+#define HTTP_WEBSOCKET_H
+
+
+
+#include <Arduino.h>
+
+#include "HTTPClient.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+
+
+// Stack buffer frames are masked into before they are written and read into before they are parsed
+#ifndef HTTP_WEBSOCKET_BLOCK_SIZE
+#define HTTP_WEBSOCKET_BLOCK_SIZE 128
+#endif
+
+// Keys and masks come from the platform's hardware or kernel generator (ESP32, ESP8266, Linux), anywhere else the build stops.
+// Defining this accepts the predictable random() instead, only for testing against servers you control
+// #define HTTP_WEBSOCKET_INSECURE_RANDOM
+
+
+
+typedef enum EHTTPWebSocketState : uint8_t {
+  WebSocketClosed,
+  WebSocketOpen,
+  WebSocketClosing,     // our close frame was sent, waiting for the server's
+} HTTPWebSocketState;
+
+// Opcodes of RFC 6455 section 5.2
+typedef enum EHTTPWebSocketOpcode : uint8_t {
+  WebSocketContinuation = 0x0,
+  WebSocketText = 0x1,
+  WebSocketBinary = 0x2,
+  WebSocketClose = 0x8,
+  WebSocketPing = 0x9,
+  WebSocketPong = 0xA,
+} HTTPWebSocketOpcode;
+
+// Called with the pieces of a text or binary message as they arrive, final is set on the last piece of the message.
+// Fragmented messages arrive as one piece after the other, the data lives in a buffer reused for the next piece
+typedef std::function<void(HTTPWebSocketOpcode type, const uint8_t* data, size_t length, bool final)> HTTPWebSocketCallback;
+
+
+
+// A WebSocket (RFC 6455) connection, opened with an upgrade request through the client and then framed on the same connection.
+// Messages are streamed in both directions, frames are masked block by block on the way out and handed to the callback block by block
+// on the way in, so no message is ever held whole. Pings are answered, fragmented messages reassembled in order and the close handshake
+// completed. No extensions are negotiated, permessage-deflate included.
+// The client is used for the WebSocket only while it is open
+class HTTPWebSocket
+{
+public:
+  HTTPWebSocket(HTTPClient& client) : client(client) {}
+
+  // Sends the upgrade request and checks the server's 101 answer and Sec-WebSocket-Accept.
+  // protocols is an optional Sec-WebSocket-Protocol list, inHeaders are sent along (e.g. Authorization)
+  bool connect(const char* hostname, uint16_t port, const char* path, const char* protocols = nullptr, const char* inHeaders = nullptr);
+
+  void onMessage(HTTPWebSocketCallback callback) { this->callback = callback; }
+  // Ping the server after interval ms without traffic and drop the connection when no pong comes back within another interval, 0 (the default) turns it off
+  void setPingInterval(unsigned long interval) { pingInterval = interval; }
+
+  // Call from the loop, handles whatever frames have arrived without waiting for more. Returns true until the connection is closed
+  bool poll();
+
+  // A whole message, or with final false the first of its fragments, the following ones follow with sendContinuation
+  bool sendText(const char* text, bool final = true) { return sendMessage(HTTPWebSocketOpcode::WebSocketText, (const uint8_t*)text, strlen(text), final); }
+  bool sendBinary(const uint8_t* data, size_t length, bool final = true) { return sendMessage(HTTPWebSocketOpcode::WebSocketBinary, data, length, final); }
+  bool sendContinuation(const uint8_t* data, size_t length, bool final);
+  bool ping(const uint8_t* data = nullptr, size_t length = 0);
+
+  // Starts the close handshake, poll finishes it
+  bool close(uint16_t code = 1000, const char* reason = nullptr);
+
+  HTTPWebSocketState state() const { return currentState; }
+  // The protocol the server picked, "" when none
+  const char* protocol() const { return selectedProtocol; }
+  // The status code of the server's close frame, 1005 when it had none and 1006 when the connection dropped without one
+  uint16_t closeCode() const { return receivedCloseCode; }
+
+protected:
+  bool sendMessage(HTTPWebSocketOpcode opcode, const uint8_t* data, size_t length, bool final);
+  bool writeFrame(uint8_t opcode, const uint8_t* data, size_t length, bool final);
+  void consume(const uint8_t* data, size_t length);
+  bool beginFrame();
+  void endFrame(bool empty);
+  void fail(uint16_t code);
+  void shutdown();
+
+protected:
+  HTTPClient& client;
+  HTTPWebSocketCallback callback;
+  HTTPWebSocketState currentState = HTTPWebSocketState::WebSocketClosed;
+  char selectedProtocol[32] = "";
+  uint16_t receivedCloseCode = 1006;
+
+  unsigned long pingInterval = 0;
+  unsigned long activityAt = 0;     // last frame received
+  unsigned long pingSentAt = 0;
+  bool awaitingPong = false;
+  unsigned long closingAt = 0;
+  unsigned long closeTimeout = 2000;
+
+  bool sendingFragments = false;    // a message was started with final false
+
+  // Frame being received
+  uint8_t header[14];
+  uint8_t headerLength = 0;
+  bool inPayload = false;
+  bool frameFinal = false;
+  uint8_t frameOpcode = 0;
+  uint64_t payloadLeft = 0;
+  uint8_t messageOpcode = 0;        // opcode of the fragmented message being received, 0 when there is none
+  uint8_t control[125];             // control frame payloads are collected whole
+  uint8_t controlLength = 0;
+};
+
+
+
+#endif // HTTP_WEBSOCKET_H
@@ -0,0 +1,219 @@
+// Host side stress test for running separate HTTPClient instances at the same time, one instance per thread over its own mock Client.
+// Every thread sends a series of GETs on a keep-alive connection and reads back Content-Length and chunked bodies, alternating the
+// stack buffer and the shared buffer pool, and checks each status, body length and every body byte against what its server sent.
+// The mock hands out the responses a few bytes at a time so the header and chunk parsers see every kind of split.
+//
+// Build and run from the library root, ThreadSanitizer reports any state the instances share without synchronisation:
+//   g++ -std=c++17 -O1 -g -fsanitize=thread -pthread -Iextras/test/host -I. extras/test/ClientStress.cpp \
+//     HTTPClient.cpp HTTPBufferPool.cpp HTTPRttEstimator.cpp HTTPCircuitBreaker.cpp HTTPUrl.cpp -o client_stress && ./client_stress
+// Optional arguments set the number of threads (8) and of requests per thread (500).
+
+#include "HTTPClient.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+
+HostSerial Serial;
+
+
+
+// Body byte k of response index of thread, different for every thread, response and position
+static uint8_t bodyByte(uint32_t thread, uint32_t index, size_t k) {
+  return (uint8_t)(thread * 131 + index * 29 + k * 7 + (k >> 8));
+}
+
+
+
+static size_t bodyLength(uint32_t thread, uint32_t index) {
+  return (thread * 977 + index * 389) % 3000;
+}
+
+
+
+// Answers every request it is sent with the next scripted response, handing it out in small reads
+class MockServer : public Client {
+public:
+  MockServer(uint32_t thread) : thread(thread), rng(thread * 2654435761u + 1) {}
+
+  int connect(IPAddress, uint16_t) override { return open(); }
+  int connect(const char*, uint16_t) override { return open(); }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    if (!isOpen) {
+      return 0;
+    }
+
+    request.append((const char*)buffer, size);
+
+    // One response per complete request head, GETs have no body
+    size_t end;
+    while ((end = request.find("\r\n\r\n")) != std::string::npos) {
+      request.erase(0, end + 4);
+      respond();
+    }
+
+    return size;
+  }
+
+  int availableForWrite() override { return 1024; }
+
+  int available() override { return (int)std::min<size_t>(response.size() - position, 1 + next() % 23); }
+  int read() override { return (position < response.size()) ? (uint8_t)response[position++] : -1; }
+  int read(uint8_t* buffer, size_t size) override {
+    size_t n = std::min(size, response.size() - position);
+
+    if (n == 0) {
+      return -1;
+    }
+
+    memcpy(buffer, response.data() + position, n);
+    position += n;
+    return (int)n;
+  }
+
+  int peek() override { return (position < response.size()) ? (uint8_t)response[position] : -1; }
+  void flush() override {}
+  void stop() override { isOpen = false; }
+  uint8_t connected() override { return isOpen || position < response.size(); }
+  operator bool() override { return isOpen; }
+  using Print::write;
+
+  uint32_t connects = 0;
+  uint32_t responses = 0;
+
+private:
+  int open() {
+    isOpen = true;
+    request.clear();
+    response.clear();
+    position = 0;
+    ++connects;
+    return 1;
+  }
+
+  uint32_t next() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+  }
+
+  void respond() {
+    uint32_t index = responses++;
+    size_t length = bodyLength(thread, index);
+    std::string body;
+
+    for (size_t k = 0; k < length; ++k) {
+      body += (char)bodyByte(thread, index, k);
+    }
+
+    // Drop what was already read so the script does not grow for ever
+    response.erase(0, position);
+    position = 0;
+
+    if (index % 2 == 0) {
+      response += "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(length) + "\r\nX-Index: " + std::to_string(index) + "\r\n\r\n" + body;
+      return;
+    }
+
+    char size[16];
+
+    response += "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nX-Index: " + std::to_string(index) + "\r\n\r\n";
+    for (size_t at = 0; at < length; ) {
+      size_t chunk = std::min<size_t>(length - at, 1 + next() % 700);
+
+      snprintf(size, sizeof(size), (next() % 2) ? "%zx" : "%zX", chunk);
+      response += std::string(size) + "\r\n" + body.substr(at, chunk) + "\r\n";
+      at += chunk;
+    }
+    response += "0\r\n\r\n";
+  }
+
+  uint32_t thread;
+  uint32_t rng;
+  bool isOpen = false;
+  std::string request;
+  std::string response;
+  size_t position = 0;
+};
+
+
+
+// Runs count requests through one client, returns the number of failed checks
+static uint32_t run(uint32_t thread, uint32_t count) {
+  MockServer server(thread);
+  HTTPClient client(server, 1000);
+  uint8_t buffer[97];
+  uint32_t failures = 0;
+
+  for (uint32_t index = 0; index < count; ++index) {
+    size_t expected = bodyLength(thread, index);
+    size_t received = 0;
+    bool matches = true;
+
+    auto check = [&](uint8_t* data, size_t length) {
+      for (size_t k = 0; k < length; ++k) {
+        matches = matches && data[k] == bodyByte(thread, index, received + k);
+      }
+      received += length;
+      return true;
+    };
+
+    auto response = client.http_get("stress.local", 80, String("/") + String(index), nullptr, nullptr);
+    long n = -1;
+
+    if (response != nullptr && response->return_status == 200) {
+      n = (index % 4 < 2) ? client.readBody(buffer, sizeof(buffer), check) : client.readBody(check);
+    }
+
+    if (response == nullptr || response->return_status != 200 || n != (long)expected || received != expected || !matches) {
+      fprintf(stderr, "thread %u request %u: status %u, %ld of %zu bytes, content %s\n", thread, index,
+        (response != nullptr) ? response->return_status : 0, n, expected, matches ? "ok" : "WRONG");
+      ++failures;
+    }
+  }
+
+  // Every request should have gone over the one keep-alive connection
+  if (server.connects != 1 || server.responses != count) {
+    fprintf(stderr, "thread %u: %u connects and %u responses for %u requests\n", thread, server.connects, server.responses, count);
+    ++failures;
+  }
+
+  return failures;
+}
+
+
+
+int main(int argc, char** argv) {
+  uint32_t threads = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 8;
+  uint32_t count = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 500;
+  std::atomic<uint32_t> failures{0};
+  std::vector<std::thread> workers;
+
+  auto started = std::chrono::steady_clock::now();
+
+  for (uint32_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&failures, t, count]() { failures += run(t, count); });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  printf("%u clients, %u requests each in %.3f s, %.0f requests/s, %u failed checks\n",
+    threads, count, seconds, threads * count / seconds, failures.load());
+  puts(failures.load() == 0 ? "OK" : "FAILED");
+
+  return (failures.load() == 0) ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+// Host side stress test and benchmark for HTTPSPSCQueue, the ring HTTPBodyPipeline hands its buffers through, one producer thread against one consumer thread.
+// Every item carries its sequence number twice, the consumer checks they arrive in order and were never torn or repeated.
+// Small capacities keep the ring wrapping and both sides bumping into the full and empty checks.
+//
+// Build and run from the library root, ThreadSanitizer reports any data race in the ring:
+//   g++ -std=c++17 -O2 -g -fsanitize=thread -pthread -I. extras/test/SPSCStress.cpp -o spsc_stress && ./spsc_stress
+// An optional argument sets the number of items per run, it defaults to 2000000.
+
+#include "HTTPSPSCQueue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+
+struct Item {
+  uint32_t sequence;
+  uint32_t check;     // ~sequence, a torn copy will not match
+  uint8_t* buffer;    // a pointer as the body pipeline queues them
+};
+
+
+
+template<size_t Capacity>
+static bool run(uint32_t count) {
+  static HTTPSPSCQueue<Item, Capacity> queue;
+  std::atomic<bool> failed{false};
+  uint32_t fullSpins = 0;
+  uint32_t emptySpins = 0;
+
+  queue.clear();
+
+  auto started = std::chrono::steady_clock::now();
+
+  std::thread producer([&]() {
+    for (uint32_t i = 0; i < count && !failed.load(std::memory_order_relaxed); ) {
+      Item item = { i, ~i, (uint8_t*)(uintptr_t)(i * 8 + 8) };
+
+      if (queue.push(item)) {
+        ++i;
+      } else {
+        ++fullSpins;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::thread consumer([&]() {
+    Item item;
+
+    for (uint32_t expected = 0; expected < count; ) {
+      if (!queue.pop(item)) {
+        ++emptySpins;
+        std::this_thread::yield();
+        continue;
+      }
+
+      if (item.sequence != expected || item.check != ~expected || item.buffer != (uint8_t*)(uintptr_t)(expected * 8 + 8)) {
+        fprintf(stderr, "capacity %zu: expected item %u, got %u (check %08x)\n", Capacity, expected, item.sequence, item.check);
+        failed.store(true);
+        return;
+      }
+
+      if (queue.size() > Capacity) {
+        fprintf(stderr, "capacity %zu: size %zu over capacity\n", Capacity, queue.size());
+        failed.store(true);
+        return;
+      }
+
+      ++expected;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  if (!failed.load() && !queue.empty()) {
+    fprintf(stderr, "capacity %zu: %zu items left over\n", Capacity, queue.size());
+    failed.store(true);
+  }
+
+  printf("capacity %5zu: %u items in %.3f s, %.1f M items/s, %u full and %u empty retries%s\n",
+    Capacity, count, seconds, count / seconds / 1e6, fullSpins, emptySpins, failed.load() ? " FAILED" : "");
+
+  return !failed.load();
+}
+
+
+
+int main(int argc, char** argv) {
+  uint32_t count = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 2000000;
+  bool ok = true;
+
+  ok = run<1>(count / 16) && ok;
+  ok = run<2>(count / 4) && ok;
+  ok = run<8>(count) && ok;
+  ok = run<64>(count) && ok;
+  ok = run<1024>(count) && ok;
+
+  puts(ok ? "OK" : "FAILED");
+
+  return ok ? 0 : 1;
+}
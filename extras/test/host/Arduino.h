@@ -0,0 +1,220 @@
+// Just enough of the Arduino core to build the library on a host for the tests in extras/test, not a port of it.
+// Serial output is discarded, the tests report on stdout themselves
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define PSTR(s) (s)
+#define PROGMEM
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+
+inline unsigned long millis() {
+  static const auto started = std::chrono::steady_clock::now();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+inline unsigned long micros() {
+  static const auto started = std::chrono::steady_clock::now();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void yield() { std::this_thread::yield(); }
+
+// Not the Arduino generator, only its interface. Per thread so the stress tests do not race on it
+inline long random(long howBig) {
+  static thread_local uint32_t state = 2463534242u ^ (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return (howBig > 0) ? (long)(state % (uint32_t)howBig) : 0;
+}
+
+inline long random(long howSmall, long howBig) { return howSmall + random(howBig - howSmall); }
+
+
+
+class String {
+public:
+  String() {}
+  String(const char* text) : s(text != nullptr ? text : "") {}
+  String(const __FlashStringHelper* text) : s((const char*)text) {}
+  String(char c) : s(1, c) {}
+  String(int value) : s(std::to_string(value)) {}
+  String(unsigned int value) : s(std::to_string(value)) {}
+  String(long value) : s(std::to_string(value)) {}
+  String(unsigned long value) : s(std::to_string(value)) {}
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.length(); }
+  bool reserve(unsigned int size) { s.reserve(size); return true; }
+
+  String& trim() {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    size_t last = s.find_last_not_of(" \t\r\n");
+    s = (first == std::string::npos) ? std::string() : s.substr(first, last - first + 1);
+    return *this;
+  }
+
+  bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.length(), prefix.s) == 0; }
+  bool endsWith(const String& suffix) const { return s.length() >= suffix.s.length() && s.compare(s.length() - suffix.s.length(), suffix.s.length(), suffix.s) == 0; }
+  int indexOf(char c, unsigned int from = 0) const { return position(s.find(c, from)); }
+  int indexOf(const String& text, unsigned int from = 0) const { return position(s.find(text.s, from)); }
+  int lastIndexOf(char c) const { return position(s.rfind(c)); }
+  String substring(unsigned int from) const { return (from < s.length()) ? String(s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const { return (from < s.length()) ? String(s.substr(from, to - from)) : String(); }
+  bool equalsIgnoreCase(const String& other) const {
+    return s.length() == other.s.length() && std::equal(s.begin(), s.end(), other.s.begin(), [](char a, char b) { return tolower(a) == tolower(b); });
+  }
+  void toLowerCase() { for (char& c : s) { c = tolower(c); } }
+  long toInt() const { return atol(s.c_str()); }
+
+  bool concat(const char* text, unsigned int length) { s.append(text, length); return true; }
+  String& operator+=(const String& other) { s += other.s; return *this; }
+  String& operator+=(const char* text) { s += text; return *this; }
+  String& operator+=(const __FlashStringHelper* text) { s += (const char*)text; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  String& operator+=(int value) { s += std::to_string(value); return *this; }
+  String& operator+=(unsigned int value) { s += std::to_string(value); return *this; }
+  String& operator+=(long value) { s += std::to_string(value); return *this; }
+  String& operator+=(unsigned long value) { s += std::to_string(value); return *this; }
+
+  friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+  friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.s); }
+  friend String operator+(const String& a, const __FlashStringHelper* b) { return String(a.s + (const char*)b); }
+  friend String operator+(const __FlashStringHelper* a, const String& b) { return String((const char*)a + b.s); }
+
+  bool operator==(const String& other) const { return s == other.s; }
+  bool operator==(const char* other) const { return s == other; }
+  bool operator!=(const String& other) const { return s != other.s; }
+  bool operator!=(const char* other) const { return s != other; }
+  char operator[](unsigned int i) const { return s[i]; }
+  char& operator[](unsigned int i) { return s[i]; }
+
+private:
+  String(const std::string& text) : s(text) {}
+  static int position(size_t at) { return (at == std::string::npos) ? -1 : (int)at; }
+
+  std::string s;
+};
+
+
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size-- > 0) { n += write(*buffer++); }
+    return n;
+  }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+  size_t write(const char* text, size_t size) { return write((const uint8_t*)text, size); }
+  size_t print(const char* text) { return write(text); }
+  size_t print(const __FlashStringHelper* text) { return write((const char*)text); }
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned long value, int base = 10) { char b[24]; snprintf(b, sizeof(b), (base == 16) ? "%lX" : "%lu", value); return write(b); }
+  size_t print(long value) { char b[24]; snprintf(b, sizeof(b), "%ld", value); return write(b); }
+  size_t print(unsigned int value, int base = 10) { return print((unsigned long)value, base); }
+  size_t print(int value) { return print((long)value); }
+  size_t println() { return write("\r\n"); }
+  template<typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+  size_t println(unsigned long value, int base) { size_t n = print(value, base); return n + println(); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    size_t n = vprint(format, args);
+    va_end(args);
+    return n;
+  }
+
+  size_t printf(const __FlashStringHelper* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t n = vprint((const char*)format, args);
+    va_end(args);
+    return n;
+  }
+
+private:
+  size_t vprint(const char* format, va_list args) {
+    char b[256];
+    int n = vsnprintf(b, sizeof(b), format, args);
+    return (n > 0) ? write((const uint8_t*)b, std::min<size_t>(n, sizeof(b) - 1)) : 0;
+  }
+};
+
+
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+  unsigned long getTimeout() { return timeout; }
+
+  size_t readBytes(char* buffer, size_t length) {
+    size_t n = 0;
+    int c;
+    while (n < length && (c = timedRead()) >= 0) { buffer[n++] = (char)c; }
+    return n;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+
+protected:
+  int timedRead() {
+    unsigned long start = millis();
+    do {
+      int c = read();
+      if (c >= 0) { return c; }
+      yield();
+    } while (millis() - start < timeout);
+    return -1;
+  }
+
+  unsigned long timeout = 1000;
+};
+
+
+
+class HostSerial : public Stream {
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t size) override { return size; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void begin(unsigned long) {}
+};
+
+extern HostSerial Serial;
+
+
+
+#endif // HOST_ARDUINO_H
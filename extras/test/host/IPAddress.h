@@ -0,0 +1,11 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+
+class IPAddress {
+public:
+  uint8_t octets[4] = {};
+};
+
+#endif // HOST_IPADDRESS_H